@@ -11,37 +11,217 @@ system, lifelines to assist players, and comprehensive score tracking.
 
 KEY FEATURES:
 - Multiple quiz categories (Science, Computer, Sports, History, IQ/Logic)
-- Three difficulty levels (Easy, Medium, Hard)
+- Three difficulty levels (Easy, Medium, Hard) and Adaptive
 - Timed questions with countdown display
 - Four lifelines: 50/50, Skip Question, Replace Question, Extra Time
 - Streak bonus system for consecutive correct answers
 - Negative marking for wrong/timed-out answers
 - Review incorrect answers after quiz completion
 - High score leaderboard with persistent storage
-- Detailed quiz logs with timestamps
+- Ranked leaderboard index (top-K, player rank, pages by category/difficulty)
+- Detailed quiz logs with timestamps, stored by column and queried from the CLI
 - Post-quiz menu with replay and review options
+- Per-player question history: new sessions and Replace prefer unseen questions
+- Game rules in a headless QuizSession engine; the console UI is a client of it
+- Every session recorded as (seed, inputs) and replayable with --replay
+- Monte Carlo simulator for tuning streak bonuses and negative marking
+- Full-text search over every question and option with --search
+- Near-duplicate questions reported within and across banks (--duplicates, and on --compile)
+- Answer latency, timeouts, lifelines and correctness per category exported for Prometheus
+- Opt-in session-flow tracing (--trace) viewable in chrome://tracing or Perfetto
+- Adaptive difficulty: each question is picked near the player's Elo rating in the category
+- Lifetime statistics of every question; --question-stats lists the hardest and easiest
 
 TECHNICAL FEATURES:
-- Question shuffling for randomization
-- Real-time timer display using Windows console API
+- Question shuffling for randomization (seeded PCG32 generator per session)
+- Session state holds question IDs and a permutation byte, not text; variable-size
+  state lives in a per-session arena, so questions are played without heap allocations
+- Screens drawn as frames; only changed cells are sent, as ANSI escapes in one write
+- Real-time timer display (one-cell update per tick)
 - Non-blocking keyboard input detection
 - File-based persistent storage for questions, scores, and logs
 - Dynamic question loading based on difficulty and category
+- Questions grouped by their difficulty tag at load time (any bank size/order)
+- Server mode hosting many sessions over a line-based TCP protocol
+- Hierarchical timer wheel for question deadlines in server mode
+- Question banks compiled to a binary format and memory-mapped at load
+- Question and option text interned into a per-bank string pool (records hold 32-bit IDs)
+- All five banks loaded once at startup (in parallel) and shared; edits reload in place
+- Scores and logs group-committed by a background writer (lock-free queue)
+- Inverted word index per bank: sorted terms, ID lists for rare words, bitmaps for
+  common ones; multi-word queries intersect shortest list first
+- MinHash signatures (text words and word pairs, option words) bucketed by LSH bands,
+  so near-duplicates are found without comparing every pair of questions
+- Answer metrics in per-thread HDR-style histograms and counters (owner-only relaxed
+  stores, about 8 ns an event), summed without locks when exported
+- Scoped trace spans in per-thread ring buffers; off, a span costs one relaxed load
+- Elo ratings of players and questions in a memory-mapped table; an ordered index per
+  category finds the questions nearest a rating in O(log n), and an answer updates
+  both ratings in O(1) and re-keys one index node in O(log n) without allocating
+- Per-question counters bumped with relaxed atomics straight in a memory-mapped table
+  (about 20 ns a closed question), flushed to disk by a sync thread
 
 GAME MECHANICS:
 - 10 questions per quiz session
 - Base points: 1 point per correct answer
 - Streak bonuses: +5 at 3 streak, +15 at 5 streak
-- Negative marking: -2 (Easy), -3 (Medium), -5 (Hard)
+- Negative marking: -2 (Easy), -3 (Medium), -5 (Hard); Adaptive uses each question's tag
 - Timer: 15 seconds per question (extensible with lifeline)
 
 FILES REQUIRED:
 - science.txt, computer.txt, sports.txt, history.txt, iq.txt (question banks)
+- science.qbk, computer.qbk, ... (compiled banks, rebuilt automatically)
 - high_scores.txt (leaderboard storage)
-- quiz_logs.txt (detailed session logs)
+- quiz_logs.qcl (columnar session log, created on first use)
+- quiz_logs.txt (old text session log, read only by --logimport)
+- seen_history.idx, seen_history.dat (questions each player has seen, created on first use)
+- session_traces.txt (seed and inputs of every session, created on first use)
+- quiz_metrics.prom (answer metrics in Prometheus text format, rewritten every 10 s)
+- ratings.qrt (player and question ratings, created at startup)
+- question_stats.qst (lifetime counters of every question, created at startup)
 
 QUESTION FORMAT IN FILES:
-Question|Option1|Option2|Option3|Option4|CorrectAnswerNumber
+Question|Option1|Option2|Option3|Option4|CorrectAnswerNumber|DifficultyTag
+
+COMPILED BANK FORMAT (.qbk):
+header (magic "QBNK", version, count, string count, source size/time,
+malformed source lines skipped), then one fixed-size record per question,
+then the string pool. Each record holds
+the correct-answer byte, the difficulty byte and five uint32 string IDs
+(question, options 1-4). The pool is a uint32 offset table with one entry per
+distinct string plus an end entry, then the text back to back (no
+terminators). Every question and option text is stored once per bank, so
+repeated options cost 4 bytes and equal text has equal IDs. A bank whose
+distinct text passes 4 GB does not compile.
+
+SESSION LOG FORMAT (.qcl):
+Appended blocks, one per writer commit (or per 65,536 imported sessions).
+Each block: header (magic "QCLB", version, rows, players, dictionary and block
+sizes), a player dictionary (uint16 lengths, then the names), then one array
+per column: int64 time, uint32 player index, uint32 outcomes (3 bits per
+question, an AnswerResult), int16 score, uint8 category, difficulty, correct
+and wrong. Blocks are padded to 8 bytes so every column is aligned when mapped.
+
+SEEN HISTORY FORMAT (seen_history.idx/.dat):
+The index is a header (magic "QSIX", version, capacity, used) and an
+open-addressing table of (key hash, record offset) slots that doubles at 70%
+load. Keys are "<category>:<player>". The data file holds records (hash, key,
+reserved capacity, bitmap) that are rewritten in place while they fit and
+appended otherwise. Bitmaps are Roaring-style: one container per 65,536 IDs,
+a sorted uint16 array up to 4,096 IDs and an 8 KB bitmap beyond that. Only
+the slots and records of the players being served are read.
+
+RATINGS FORMAT (ratings.qrt, mapped read-write):
+header (magic "QRTG", version, questions per category 1-5, player slots,
+players), then a (float rating, uint32 answers) pair per question of each
+category by ID, then an open-addressing table of (key, rating, answers) player
+slots; the key is the hash of "<category>:<player>", 0 = empty. Players are
+added when a session starts, never by an answer. The file is rewritten (and
+swapped in) only at startup, when a bank has gained questions or the player
+table is over a quarter full, and by a session start that takes the table past
+half full; either way the table doubles. Ratings are Elo (400-point scale)
+with K falling from 64 to 16 for players and 32 to 8 for questions as answers
+add up. Picks come from a per-category ordered index rebuilt at startup (a
+reload that adds questions rates them and adds them to it); the player's
+unseen questions in the pick window are drawn first. Each
+category has its own lock, so answers in different categories never wait on
+each other.
+
+QUESTION STATISTICS FORMAT (question_stats.qst, mapped read-write):
+header (magic "QSTS", version, questions per category 1-5), then one 40-byte
+record per question of each category by ID: uint32 shown, correct, wrong,
+timed out, 50/50 used, skipped, replaced and a reserved word, then uint64
+microseconds to answer summed over correct and wrong answers. Sessions in any
+thread add to the records in place; the file is flushed every 10 s and
+rewritten only at startup when a bank has gained questions, so questions a
+reload adds are counted from the next start.
+
+SESSION TRACE FORMAT (session_traces.txt, one line per session):
+datetime|category difficulty timer|seed (hex)|bank source size:time|
+seen history|inputs|score outcomes|player
+The seen history holds only what the question order depended on: "seen" and
+the seen IDs passed over before the last unseen question a session can reach,
+or "unseen" and the pool's unseen IDs when it has fewer than that ("-" if no
+history). Inputs are A<slot> (answer), L<5-8> (lifeline), T<seconds> (clock) and
+Q<id> (question picked by an adaptive session, difficulty 4), in order. Each session draws its question order and option shuffles from its own
+PCG32 generator, so the seed and inputs reproduce it exactly.
+
+COMMAND LINE:
+  "QUIZ GAME.exe" --compile <bank.txt> [bank.qbk]   Compile a bank ahead of time
+  "QUIZ GAME.exe" --bench-tokenizer [lines]         Compare cut() with split_record()
+  "QUIZ GAME.exe" --bench [out.json] [max rows]     Time the hot paths on synthetic banks and
+                                                     score files from 1K rows up to max rows
+                                                     (default 1M, 10M supported); JSON results
+  "QUIZ GAME.exe" --server [port] [workers]          Host sessions over TCP (default 5050)
+  "QUIZ GAME.exe" --server-load [port] [clients] [sessions]
+                                                     Play bot sessions against a server
+  "QUIZ GAME.exe" --loadtest [players] [sessions] [accuracy] [think] [lifeline rate]
+                                                     Simulated players on the session engine,
+                                                     one thread each; think is none,
+                                                     fixed:<ms>, uniform:<lo>-<hi> or
+                                                     exp:<mean ms>. Reports sessions/s, latency
+                                                     percentiles and allocations per session
+                                                     (and on the question path, expected 0)
+  "QUIZ GAME.exe" --check-allocations [sessions]     Play sessions (default 200) per category and
+                                                     difficulty, fresh and reused, with every
+                                                     lifeline and a 1 s clock that runs out;
+                                                     exits 1 if any allocates between start and
+                                                     finish (--loadtest fails the same way)
+  "QUIZ GAME.exe" --simulate [sessions] [threads] [out.json]
+                                                     Play synthetic sessions (default 1M per cell)
+                                                     for 72 scoring rule sets x 4 skill models x
+                                                     3 difficulties on all cores; writes score
+                                                     histograms, moments, percentiles and
+                                                     leaderboard skew (top-10 skill share, rank
+                                                     correlation with skill) as JSON
+  "QUIZ GAME.exe" --logquery [keys] [log.qcl]       Sessions, average/min/max score, average
+                                                     correct and timeouts grouped by keys:
+                                                     category,difficulty,day,player or all
+                                                     (default category,day)
+  "QUIZ GAME.exe" --logimport [log.txt] [log.qcl]   Append the old text log to the session log
+  "QUIZ GAME.exe" --logdump [log.qcl]               Print the session log as text
+  "QUIZ GAME.exe" --replay [traces.txt] [player|line] Replay recorded sessions and check each
+                                                     reaches its recorded score and outcomes
+  "QUIZ GAME.exe" --search [query] [category]       Questions whose text or options contain every
+                                                     word (word* for a prefix) in all banks or
+                                                     category 1-5; no query asks for them in turn
+  "QUIZ GAME.exe" --duplicates [similarity] [report.txt]
+                                                     Clusters of near-duplicate questions in and
+                                                     across all banks (default similarity 0.75,
+                                                     report duplicates.txt)
+  "QUIZ GAME.exe" --question-stats [count] [category] Hardest and easiest questions (default 10
+                                                     each) by share of answers wrong or timed out,
+                                                     among those answered 5+ times
+  Options for any mode:
+  --flush-ms <ms>                                    Writer batch interval (default 200)
+  --fsync off|commit                                 Flush every batch to disk (default off)
+  --metrics <file>|off                               Answer metrics dump (default quiz_metrics.prom;
+                                                     console game, server and --loadtest)
+  --metrics-ms <ms>                                  Metrics dump interval (default 10000)
+  --stats-ms <ms>                                    Question statistics sync interval (default 10000)
+  --trace <trace.json>                               Record spans (bank loads, rendering, input
+                                                     waits, session start, log/score writes,
+                                                     server lines) and write Chrome trace JSON
+                                                     at exit; each thread keeps its last 16,384
+                                                     spans
+
+SERVER PROTOCOL (one command or reply per line):
+  client: START <category 1-5> <difficulty 1-4> <name> | ANSWER <1-4> |
+          LIFELINE <5-8> | QUIT  (the name is the rest of the START line)
+  server: QUESTION <n> <seconds>|<question>|<opt1>|<opt2>|<opt3>|<opt4>
+          RESULT <CORRECT|WRONG|TIMEOUT|SKIPPED|REPLACED> <points> <score> <correct slot>
+          LIFELINE <5-8> <OK|USED>, END <score> <correct> <wrong>, ERROR <reason>
+  GET /metrics (an HTTP request line) is answered with the answer metrics
+  and the connection closed, so Prometheus can scrape the game port.
+  A START's seen-question history is read on a loader thread, so no worker
+  waits on the disk. All sessions share one copy of each bank. Edited bank
+  files are reloaded by a watcher thread and published as a new snapshot;
+  running sessions keep the bank they started on. Workers each run a WSAPoll loop and race to
+  accept on the shared listening socket. Question deadlines live in a
+  per-worker timer wheel (100 ms ticks), so an idle timed question costs
+  nothing until it expires.
+  Target: 5,000 sessions/s with p99 answer-to-feedback latency under 5 ms
+  on loopback with 4 workers (measured with --server-load).
 
 AUTHORS: [Your Name/Team Name]
 DATE: [Current Date]
@@ -58,908 +238,7608 @@ VERSION: 1.0
 #include <algorithm>
 #include <chrono>
 #include <thread>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <charconv>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+#include <unordered_map>
+#include <set>
+#include <climits>
+#include <bitset>
+#include <functional>
+#include <cstdio>
+#include <random>
+#include <cmath>
+#include <new>
+#include <sstream>
+#include <winsock2.h>
+#include <ws2tcpip.h>
 #include <windows.h>
 #include <conio.h>
+#pragma comment(lib, "Ws2_32.lib")
 using namespace std;
 
 // ---------- GLOBAL CONSTANTS ----------
-const int totalquestions = 150;      // Maximum questions that can be loaded from file
 const int sessionquestions = 10;     // Number of questions per quiz session
+const uint32_t bankversion = 3;      // Compiled question bank format version
+const int maxfields = 8;             // Most fields a delimited line may have
+const int outcomebits = 3;           // Bits per question outcome (one AnswerResult)
+const uint32_t logversion = 1;       // Columnar session log format version
+const int logblockrows = 65536;      // Sessions per block when importing the text log
+const int seenarraymax = 4096;       // Largest array container before it becomes a bitmap
+const uint32_t seenversion = 1;      // Seen-question history format version
+const uint64_t seeninitialslots = 1024; // Index slots in a new history store (power of 2)
+
+// ---------- DELIMITED RECORDS ----------
+// One delimited line split into fields; the views point into the line itself
+struct Record {
+    string_view fields[maxfields];
+    int count = 0;
+};
+
+// ---------- COMPILED QUESTION BANK ----------
+// File header of a compiled (.qbk) question bank
+struct BankHeader {
+    char magic[4];                   // "QBNK"
+    uint32_t version;                // Format version (bankversion)
+    uint32_t count;                  // Number of questions in the bank
+    uint32_t strings;                // Distinct strings in the string pool
+    uint64_t source_size;            // Size of the .txt the bank was compiled from
+    uint64_t source_time;            // Last write time of that .txt
+    uint32_t rejected;               // Malformed source lines skipped by the compiler
+    uint32_t reserved;               // Padding, always 0
+};
+
+// One question record; its text is in the bank's string pool
+struct BankRecord {
+    uint8_t correct;                 // Correct option (0-3)
+    uint8_t difficulty;              // Difficulty tag (1-3)
+    uint16_t reserved;               // Padding, always 0
+    uint32_t text[5];                // String IDs of the question and 4 options
+};
+
+// Deduplicated text while a bank is compiled
+struct StringPool {
+    string bytes;                    // Every distinct string back to back
+    vector<uint32_t> offsets{ 0 };   // Start of string i in bytes; the extra last entry is the end
+    vector<uint32_t> slots;          // Open-addressing table of string ID + 1, 0 = empty
+};
+
+struct TextIndex;
+
+// A memory-mapped compiled bank
+struct QuestionBank {
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = NULL;
+    const char* base = nullptr;      // Start of the mapped file
+    const BankRecord* records = nullptr; // One fixed-size record per question
+    const uint32_t* string_offsets = nullptr; // String pool: start of each string, then the end
+    const char* strings = nullptr;   // String pool text
+    int count = 0;                   // Number of questions
+    int string_count = 0;            // Distinct strings
+    int rejected = 0;                // Malformed source lines left out of the bank
+    vector<int> pool[4];             // Question IDs per difficulty tag (1-3), built at load
+    shared_ptr<const TextIndex> index; // Inverted index for --search, built at load when bank_indexing is set
+    string image;                    // The compiled bank itself when built in memory (hot reload)
+    uint64_t size = 0;               // Bytes of the compiled bank
+};
+
+// Pointers into the mapped bank for one question (no copies made)
+struct QuestionView {
+    const char* text[5];             // Question text, then options 1-4
+    int length[5];
+    uint32_t text_id[5];             // String pool IDs: equal text has equal IDs
+    int correct;                     // Correct option (0-3)
+    int difficulty;                  // Difficulty tag (1-3)
+};
+
+// ---------- SEEN-QUESTION HISTORY ----------
+// One 65,536-ID chunk of a seen set: sorted IDs while sparse, a bitmap once dense
+struct SeenContainer {
+    uint16_t high = 0;               // ID >> 16
+    vector<uint16_t> values;         // Array container: sorted low halves
+    vector<uint64_t> bits;           // Bitmap container: 1024 words (empty for arrays)
+};
+
+// Roaring-style compressed set of the question IDs a player has seen in one category
+struct SeenBitmap {
+    vector<SeenContainer> containers;  // Sorted by high
+
+    bool contains(uint32_t id) const;
+    void add(uint32_t id);
+
+    // Sets the bits of all IDs below limit in a flat bitset
+    void fill(vector<uint64_t>& dense, uint32_t limit) const;
+
+    void serialize(string& out) const;
+    bool deserialize(string_view data);
+};
+
+// Header of seen_history.idx, followed by capacity slots
+struct SeenIndexHeader {
+    char magic[4];                   // "QSIX"
+    uint32_t version;                // Format version (seenversion)
+    uint64_t capacity;               // Slots, a power of 2
+    uint64_t used;                   // Occupied slots
+};
+
+// Index slot: open addressing with linear probing on the key hash
+struct SeenSlot {
+    uint64_t hash;
+    uint64_t offset;                 // Record offset in seen_history.dat + 1, 0 = empty
+};
+
+// Record in seen_history.dat: header, key, then the serialized bitmap
+struct SeenRecordHeader {
+    uint64_t hash;
+    uint16_t key_length;
+    uint16_t reserved;
+    uint32_t capacity;               // Bytes reserved for the bitmap (rewritten in place while it fits)
+    uint32_t bitmap_bytes;
+    uint32_t reserved2;
+};
+
+// Persistent history of every player: only the slots and records touched are read
+struct SeenStore {
+    fstream index;                   // seen_history.idx
+    fstream data;                    // seen_history.dat
+    SeenIndexHeader header;
+    bool open = false;
+    mutex lock;                      // Server workers load while the writer thread adds
+};
+
+// ---------- ADAPTIVE DIFFICULTY ----------
+const int adaptivelevel = 4;         // Difficulty number of adaptive sessions
+const int adaptivewindow = 16;       // Nearest-rated questions a pick is drawn from
+const uint32_t ratingversion = 1;    // ratings.qrt format version
+const uint32_t ratingplayerslots = 1024; // Initial player table size (doubles past half full)
+const uint32_t ratingheadroom = 4;   // Startup grows the player table to this many slots per player
+const float ratingstart = 1500;      // Rating of a new player
+const float ratingprior[4] = { 1500, 1200, 1500, 1800 }; // Rating of a new question by difficulty tag
+const float ratingtarget = 70;       // Picks aim this far below the player (about 60% correct)
+const float ratingmin = 100, ratingmax = 3900;
+const float playerkmin = 16, playerkmax = 64; // Elo K factor of players, settled and new
+const float questionkmin = 8, questionkmax = 32; // Elo K factor of questions, settled and new
+const float ratingsettle = 20;       // Answers after which K is halfway to its minimum
+
+// Header of ratings.qrt; the question ratings of categories 1-5 follow, then the player table
+struct RatingHeader {
+    char magic[4];                   // "QRTG"
+    uint32_t version;                // Format version (ratingversion)
+    uint32_t questions[6];           // Question ratings held per category (index 0 unused)
+    uint32_t player_slots;           // Player table size, a power of 2
+    uint32_t players;                // Occupied slots
+};
+
+// An Elo rating and the answers that have moved it (K shrinks as they add up)
+struct Rating {
+    float value;
+    uint32_t answers;
+};
+
+// Player table slot: open addressing with linear probing on the key
+struct PlayerRating {
+    uint64_t key;                    // rating_player_key(), 0 = empty
+    Rating rating;
+};
+
+// Every question's and player's rating, mapped read-write; picks go through the index
+struct RatingStore {
+    string path;
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = NULL;
+    char* base = nullptr;            // Mapped file, nullptr when closed
+    size_t size = 0;
+    RatingHeader* header = nullptr;
+    Rating* questions[6] = {};       // Per category, indexed by question ID
+    PlayerRating* players = nullptr;
+    set<uint64_t> index[6];          // rating_order() << 32 | question ID, per category
+    mutex lock[6];                   // Per category: its question ratings, index and players' ratings;
+                                     // adding a player or remapping the table takes all five
+};
+
+// ---------- QUESTION STATISTICS ----------
+const uint32_t statsversion = 1;     // question_stats.qst format version
+const uint32_t statsminanswers = 5;  // Answers before --question-stats ranks a question
+
+// Header of question_stats.qst; each category's counters follow, by question ID
+struct StatsHeader {
+    char magic[4];                   // "QSTS"
+    uint32_t version;                // Format version (statsversion)
+    uint32_t questions[6];           // Questions held per category (index 0 unused)
+};
+
+// Lifetime counters of one question, bumped with relaxed atomics in the mapped file
+struct QuestionStats {
+    atomic<uint32_t> shown;
+    atomic<uint32_t> correct;
+    atomic<uint32_t> wrong;
+    atomic<uint32_t> timeouts;
+    atomic<uint32_t> fifty_fifty;
+    atomic<uint32_t> skipped;
+    atomic<uint32_t> replaced;
+    atomic<uint32_t> reserved;
+    atomic<uint64_t> answer_us;      // Time to answer, summed over correct and wrong answers
+};
+
+// Mapped statistics table; a sync thread flushes it to disk every interval
+struct StatsStore {
+    string path = "question_stats.qst";
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = NULL;
+    char* base = nullptr;            // Mapped file, nullptr when closed
+    size_t size = 0;
+    StatsHeader* header = nullptr;
+    QuestionStats* questions[6] = {}; // Per category, indexed by question ID
+    int interval_ms = 10000;
+    thread worker;
+    mutex lock;                      // Only for stop signalling, never taken when counting
+    condition_variable wake;
+    bool stopping = false;
+};
+
+// One question ranked by --question-stats
+struct StatsRank {
+    double missed;                   // Share of answers wrong or timed out
+    uint32_t answers;
+    int cat;
+    int id;
+};
+
+// ---------- RANDOM NUMBERS ----------
+// PCG32 (XSH RR): 64-bit state, 32-bit output; one per session, never shared
+struct Pcg32 {
+    uint64_t state = 0;
+    uint64_t inc = 1;                // Stream selector, always odd
+
+    // Restarts the sequence from a seed
+    void seed(uint64_t seed, uint64_t stream = 0xda3e39cb94b95bdbull);
+
+    // Next 32 random bits
+    uint32_t next();
+
+    // Uniform integer in [0, bound) without modulo bias
+    uint32_t below(uint32_t bound);
+};
+
+// ---------- QUIZ SESSION ENGINE ----------
+// How an open question was closed
+enum AnswerResult {
+    RESULT_NONE,                     // Question still open (or request rejected)
+    RESULT_CORRECT,
+    RESULT_WRONG,
+    RESULT_TIMEOUT,
+    RESULT_SKIPPED,                  // Skip lifeline, no penalty
+    RESULT_REPLACED                  // Replace lifeline, a new question follows
+};
+
+// Lifelines, numbered as on the answer prompt
+enum Lifeline {
+    LIFELINE_5050 = 5,
+    LIFELINE_SKIP = 6,
+    LIFELINE_REPLACE = 7,
+    LIFELINE_EXTRATIME = 8
+};
+
+// Result of an answer, lifeline or clock tick
+struct Feedback {
+    AnswerResult result = RESULT_NONE;
+    bool accepted = true;            // False if the lifeline was used up / no open question
+    int points = 0;                  // Change in score (negative for penalties)
+    int bonus = 0;                   // Streak bonus included in points
+    int correct_slot = -1;           // Displayed slot (0-3) of the correct option
+};
+
+// Streak bonuses and negative marking; the engine plays by one set, the simulator sweeps many
+struct ScoringRules {
+    int short_streak = 3;            // Correct answers in a row for the first bonus
+    int short_bonus = 5;
+    int long_streak = 5;             // ... and for the second (larger) one
+    int long_bonus = 15;
+    bool reset_after_long = true;    // The streak starts over after the second bonus
+    int penalty[4] = { 0, 2, 3, 5 }; // Points lost per wrong/timed-out answer by difficulty (1-3)
+};
+
+// The open question as the player sees it
+struct PresentedQuestion {
+    int number = 0;                  // Question number in the session (0-based)
+    int id = 0;                      // Question ID in the bank
+    QuestionView view;               // Text inside the bank
+    int order[4];                    // Displayed slot i shows option order[i]
+    bool removed[4];                 // Slots removed by 50/50
+    int correct_slot = 0;            // Displayed slot of the correct option
+    int time_limit = 0;              // Seconds allowed (grows with Extra Time)
+};
+
+// An incorrectly answered question kept for the review screen; the text is read back from the bank
+struct ReviewItem {
+    int id;                          // Question ID in the bank
+    uint8_t permutation;             // Option shown in each displayed slot, 2 bits per slot
+    uint8_t removed;                 // Slots removed by 50/50, 1 bit per slot
+    uint8_t correct_pos;             // Displayed slot of the correct option
+};
+
+// One input that changed a session, for its trace
+struct SessionInput {
+    char kind;                       // 'A' answer, 'L' lifeline, 'T' clock
+    int value;                       // Slot, lifeline number or seconds
+};
+
+// ---------- SESSION ARENA ----------
+const size_t arenablock = 4096;      // Smallest block a session arena allocates
+
+// Bump allocator for a session's variable-size state. reset() keeps the memory
+// (merged into one block), so a reused session stops allocating once it is warm.
+struct SessionArena {
+    vector<unique_ptr<char[]>> blocks;
+    vector<size_t> sizes;            // Bytes in each block
+    size_t used = 0;                 // Bytes taken from the last block
+
+    // Uninitialized memory for bytes, 16-byte aligned; valid until reset()
+    void* allocate(size_t bytes);
+
+    // Frees everything handed out at once
+    void reset();
+};
+
+// Final result of a session
+struct SessionSummary {
+    int score;
+    int correct;
+    int wrong;
+    uint32_t outcomes;               // AnswerResult of each question, outcomebits apiece
+};
+
+// One player's quiz: all game rules, no console I/O
+struct QuizSession {
+    // Setup
+    const QuestionBank* qb = nullptr;
+    int difficulty = 1;              // Difficulty level (1-3, or adaptivelevel), sets negative marking
+    int base_timer = 15;             // Default time limit per question (seconds)
+    uint64_t seed = 0;               // Seed of rng; with the inputs it reproduces the session
+    Pcg32 rng;                       // Question order and option shuffles
+    SessionArena arena;              // Holds order, seen_ids and inputs; kept across sessions
+    int* seen_ids = nullptr;         // History the order depended on (see start()), for the trace
+    int seen_count = -1;             // Entries in seen_ids (-1 if no history was given)
+    bool seen_inverted = false;      // seen_ids lists the pool's unseen IDs rather than seen ones
+    uint64_t* seen_bank = nullptr;   // Adaptive: bit per bank question seen before (nullptr without history)
+    SessionInput* inputs = nullptr;  // Inputs that changed the session, in order
+    int input_count = 0;
+    int input_capacity = 0;
+    int category = 0;                // Category recorded in the answer metrics (0: none); set after start()
+    uint64_t rating_player = 0;      // Player's key in ratings, once registered; answers update the ratings when set
+
+    // Question flow
+    int* order = nullptr;            // Shuffled question IDs for the difficulty (adaptive: -1 until picked)
+    int order_count = 0;
+    int presented[sessionquestions + 1]; // IDs shown so far, in order (a replaced one included)
+    int presented_count = 0;
+    int next_spare = 0;              // Next unused entry of order (for Replace)
+    int question_number = 0;         // Questions completed so far
+    bool question_open = false;
+    PresentedQuestion current;
+    int remaining = 0;               // Seconds left on the open question
+    chrono::steady_clock::time_point opened_at; // When the open question was shown (metrics only)
+
+    // Scoring
+    int score = 0;                   // Player's current score
+    int streak = 0;                  // Current streak of correct answers
+    int correct_count = 0;           // Count of correct answers
+    int wrong_count = 0;             // Count of wrong answers
+    uint32_t outcomes = 0;           // AnswerResult of question n at bit n * outcomebits
+    ReviewItem incorrect[sessionquestions]; // Incorrect questions for review
+    int incorrect_count = 0;
+    bool finished = false;
+
+    // Lifeline availability flags
+    bool lifeline_5050 = true;       // 50/50 lifeline (removes 2 wrong answers)
+    bool lifeline_skip = true;       // Skip question lifeline (no penalty)
+    bool lifeline_replace = true;    // Replace question lifeline (new question)
+    bool lifeline_extratime = true;  // Extra time lifeline (+10 seconds)
+
+    // Prepares a new session, unseen questions first; false if the bank has too few questions.
+    // A seed of 0 draws a fresh one
+    bool start(const QuestionBank& bank, int level, int timer = 15, const SeenBitmap* seen = nullptr,
+        uint64_t session_seed = 0);
+
+    // Opens the next question (or returns the open one); nullptr when the quiz is over
+    const PresentedQuestion* present();
+
+    // Sets the question the next present() shows in an adaptive session (replay)
+    void choose_question(int id);
+
+    // Adaptive pick: a question rated near the player, or any unshown one without ratings
+    int pick_question();
+
+    // Answers the open question with a displayed slot (0-3); anything else is wrong
+    Feedback answer(int slot);
+
+    // Uses lifeline 5-8 on the open question
+    Feedback use_lifeline(int lifeline);
+
+    // Advances the question clock; closes the question when time runs out
+    Feedback tick(int seconds);
+
+    // Ends the session and returns the final result
+    SessionSummary finish();
+
+    // Option text for a displayed slot ("[REMOVED]" after 50/50)
+    string_view option_text(int slot) const;
+
+    // Applies the penalty for a wrong or timed-out answer
+    Feedback penalize(AnswerResult result);
+
+    // Closes the open question; NONE and REPLACED leave the question number as is
+    void close_question(AnswerResult result);
+
+    // Appends one input to inputs
+    void record_input(char kind, int value);
+};
+
+// ---------- TIMER WHEEL ----------
+const int tickspersecond = 10;       // Timer wheel resolution (100 ms)
+const int wheelbits = 6;
+const int wheelsize = 1 << wheelbits; // Slots per wheel level
+const int wheellevels = 4;           // 64^4 ticks (about 46 hours) before clamping
+
+// One timer; timers live in the wheel's node array and are linked into slots
+struct TimerNode {
+    uint64_t deadline = 0;           // Tick at which the timer fires
+    void* owner = nullptr;           // Returned on expiry
+    int next = -1;
+    int prev = -1;
+    int slot = -1;                   // Slot the timer is linked into, -1 when idle
+};
+
+// Hashed hierarchical timer wheel: O(1) schedule, cancel and expiry
+struct TimerWheel {
+    uint64_t base = 0;               // Next tick to process
+    vector<TimerNode> nodes;
+    vector<int> free_nodes;
+    int heads[wheellevels * wheelsize];
+
+    TimerWheel();
+
+    // Allocates a timer handle for an owner
+    int create(void* owner);
+
+    // Frees a timer handle (cancelling it first)
+    void destroy(int timer);
+
+    // Arms (or re-arms) a timer for an absolute tick
+    void schedule(int timer, uint64_t deadline);
+
+    // Disarms a timer
+    void cancel(int timer);
+
+    // Processes ticks up to and including 'now', collecting expired owners
+    void advance(uint64_t now, vector<void*>& expired);
+
+    // Links a timer into the slot for its deadline
+    void link(int timer);
+
+    // Moves the timers of one higher-level slot down; returns the slot index
+    int cascade(int level, int index);
+};
+
+// ---------- HOT-RELOADED BANKS ----------
+const int banksettlems = 250;        // An edited bank must hold still this long before it is reloaded
+
+// The published bank of one category. Readers copy the snapshot without taking a
+// lock; a replaced bank lives on until the last session started on it ends.
+struct BankSlot {
+    atomic<shared_ptr<const QuestionBank>*> current{ nullptr };
+    atomic<int> readers{ 0 };        // Readers between loading current and copying it
+    uint64_t rejected_size = 0;      // Stamp of the last edit that failed validation
+    uint64_t rejected_time = 0;      // (watcher thread only)
+};
+
+// ---------- QUIZ SERVER ----------
+// One connected client and its session
+// A START waiting for the player's seen questions, which are read off the event loop
+struct HistoryLoad {
+    string player;
+    int category = 0;
+    int level = 0;
+    SeenBitmap seen;
+    uint64_t rating_player = 0;      // Rating key, once the loader has registered the player
+    atomic<bool> done{ false };      // Set by the loader once seen is filled
+};
+
+// Thread that reads seen-question histories for server STARTs
+struct HistoryLoader {
+    thread worker;
+    mutex lock;
+    condition_variable wake;
+    vector<shared_ptr<HistoryLoad>> queue;
+    bool stopping = false;
+};
+
+struct ClientConnection {
+    SOCKET sock = INVALID_SOCKET;
+    string inbuf;                    // Received bytes not yet forming a full line
+    string outbuf;                   // Replies waiting to be sent
+    bool closing = false;            // Close once outbuf is flushed
+    bool playing = false;            // A session is in progress
+    shared_ptr<HistoryLoad> starting; // START waiting for the history; lines after it wait too
+    string player;
+    int category = 0;
+    QuizSession session;
+    shared_ptr<const QuestionBank> bank; // Snapshot the session was started on
+    TimerWheel* wheel = nullptr;     // The worker's wheel
+    int timer = -1;                  // Deadline of the open question
+};
+
+// ---------- LEADERBOARD ----------
+const int skiplevels = 24;           // Enough skiplist levels for ~16M scores
+const int leaderboardviews = 24;     // (category 0-5) x (difficulty 0-3), 0 = any
+const int leaderboardpage = 10;      // Rows per leaderboard page
+
+// One line of high_scores.txt
+struct ScoreEntry {
+    string player;
+    int score;
+    string category;
+    string difficulty;
+    uint32_t seq;                    // File order; earlier entries win ties
+};
+
+// Indexable skiplist of entry IDs ordered by score (descending), then seq.
+// Each link stores its width (ranks skipped) so rank and position lookups are O(log n).
+struct RankedList {
+    struct Link {
+        int next;                    // Node index, -1 for end of list
+        int width;                   // Rank difference to next (size + 1 - rank at end)
+    };
+    vector<int> node_entry;          // Entry ID per node; node 0 is the head
+    vector<int> node_links;          // Offset of each node's links in 'links'
+    vector<Link> links;
+    int height = 1;                  // Levels in use
+    int size = 0;
+    uint32_t random_state = 2463534242u;
+
+    RankedList();
+
+    // Inserts an entry at its ranked position
+    void insert(int entry, const vector<ScoreEntry>& entries);
+
+    // 1-based rank of an entry that is in the list (0 if absent)
+    int rank_of(int entry, const vector<ScoreEntry>& entries) const;
+
+    // Node at a 1-based rank (-1 if out of range)
+    int node_at(int rank) const;
+};
+
+// Every score, indexed once and kept up to date by save_high_score()
+struct Leaderboard {
+    vector<ScoreEntry> entries;
+    RankedList views[leaderboardviews];
+    unordered_map<string, int> best[leaderboardviews];  // Player's best entry per view
+    bool loaded = false;
+};
+
+// ---------- COLUMNAR SESSION LOG ----------
+// One finished session, as stored in the session log
+struct SessionRow {
+    int64_t time = 0;                // Unix time the session ended
+    string player;
+    uint8_t category = 0;            // 1-5
+    uint8_t difficulty = 0;          // 1-3
+    uint8_t correct = 0;
+    uint8_t wrong = 0;
+    int16_t score = 0;
+    uint32_t outcomes = 0;           // SessionSummary::outcomes
+};
+
+// Header of one block of the session log (.qcl); blocks are appended back to back
+struct LogBlockHeader {
+    char magic[4];                   // "QCLB"
+    uint32_t version;                // Format version (logversion)
+    uint32_t rows;                   // Sessions in the block
+    uint32_t players;                // Entries in the block's player dictionary
+    uint32_t dict_bytes;             // Dictionary size, padded to 8 bytes
+    uint32_t block_bytes;            // Whole block including this header, padded to 8 bytes
+};
+
+// The columns of one block, pointing into the mapped log
+struct LogColumns {
+    const LogBlockHeader* header = nullptr;
+    const uint16_t* name_length = nullptr;  // Player dictionary: lengths, then packed names
+    const char* names = nullptr;
+    const int64_t* time = nullptr;
+    const uint32_t* player = nullptr;       // Index into the block's dictionary
+    const uint32_t* outcomes = nullptr;
+    const int16_t* score = nullptr;
+    const uint8_t* category = nullptr;
+    const uint8_t* difficulty = nullptr;
+    const uint8_t* correct = nullptr;
+    const uint8_t* wrong = nullptr;
+};
+
+// ---------- BACKGROUND WRITER ----------
+// Files the background writer appends to
+enum WriterFile {
+    WRITER_SESSIONS,                 // quiz_logs.qcl
+    WRITER_SCORES,                   // high_scores.txt
+    WRITER_HISTORY,                  // seen_history.idx/.dat, updated through the history store
+    WRITER_TRACES,                   // session_traces.txt
+    writerfiles
+};
+
+// One queued append; owned by the writer once pushed
+struct WriteRecord {
+    atomic<WriteRecord*> next{nullptr};
+    int file = WRITER_SESSIONS;
+    string text;                     // WRITER_SCORES/TRACES: lines ending in '\n'; WRITER_HISTORY: key
+    SessionRow row;                  // WRITER_SESSIONS: one session
+    vector<int> ids;                 // WRITER_HISTORY: question IDs to mark seen
+};
+
+// Intrusive MPSC queue (producers exchange head, the writer thread walks tail)
+// plus the open append handles and flush policy
+struct AsyncWriter {
+    WriteRecord stub;                // Keeps the queue non-empty between pops
+    atomic<WriteRecord*> head{&stub};
+    WriteRecord* tail = &stub;
+    string paths[writerfiles] = { "quiz_logs.qcl", "high_scores.txt", "seen_history", "session_traces.txt" };
+    HANDLE files[writerfiles] = { INVALID_HANDLE_VALUE, INVALID_HANDLE_VALUE, INVALID_HANDLE_VALUE, INVALID_HANDLE_VALUE };
+    int flush_ms = 200;              // Longest a record waits before its group commit
+    bool fsync_commits = false;      // FlushFileBuffers after every group commit
+    atomic<uint64_t> enqueued{0};
+    atomic<uint64_t> written{0};
+    uint64_t commits = 0;
+    thread worker;
+    mutex lock;                      // Only for stop/sync signalling, never taken by producers
+    condition_variable wake;         // Wakes the writer early (sync or stop)
+    condition_variable done;         // Signalled after every group commit
+    bool stopping = false;
+    bool sync_requested = false;
+};
+
+// ---------- ANSWER METRICS ----------
+const int latencysubbits = 5;        // 32 buckets per power of two: latencies kept to about 3%
+const int latencyshifts = 32;        // Powers of two above 64 us (up to about 76 hours)
+const int latencybuckets = (latencyshifts + 2) << latencysubbits;
+
+// One thread's answer metrics. Only the owning thread writes them, with plain relaxed
+// stores; the exporter sums every block with relaxed loads, so neither side locks.
+// Categories are indexed 0-4 (category - 1)
+struct ThreadMetrics {
+    atomic<uint64_t> latency[5][latencybuckets]; // Answered questions by latency bucket (microseconds)
+    atomic<uint64_t> latency_sum_us[5];
+    atomic<uint64_t> results[5][6];  // Closed questions by AnswerResult
+    atomic<uint64_t> lifelines[5][4]; // Lifelines used (5-8)
+    atomic<uint64_t> sessions[5];    // Sessions finished
+    ThreadMetrics* next = nullptr;   // Next block in the registry
+};
+
+// Every thread's metrics summed
+struct MetricsSnapshot {
+    vector<uint64_t> latency;        // 5 x latencybuckets
+    uint64_t latency_sum_us[5] = {};
+    uint64_t results[5][6] = {};
+    uint64_t lifelines[5][4] = {};
+    uint64_t sessions[5] = {};
+};
+
+// Where and how often the metrics are dumped
+struct MetricsExporter {
+    string path = "quiz_metrics.prom"; // Empty: no dump file
+    int interval_ms = 10000;
+    thread worker;
+    mutex lock;                      // Only for stop signalling, never taken when recording
+    condition_variable wake;
+    bool stopping = false;
+};
+
+// ---------- SESSION TRACING ----------
+const int traceevents = 16384;       // Spans kept per thread; older ones are overwritten
+
+// One closed span
+struct TraceEvent {
+    const char* name;                // String literals only: stored as pointers
+    const char* category;
+    int64_t start_ns;                // Since tracing started
+    int64_t duration_ns;
+};
+
+// One thread's ring of spans. Only the owner writes; the dump reads at exit
+struct TraceBuffer {
+    TraceEvent events[traceevents];
+    atomic<uint64_t> written{0};     // Spans ever written; the ring holds the last traceevents
+    uint32_t tid = 0;                // Thread ID on the timeline
+    const char* name = nullptr;      // Thread name on the timeline
+    TraceBuffer* next = nullptr;     // Next buffer in the registry
+};
+
+// Opt-in tracing (--trace) and the registry of thread buffers
+struct SessionTracer {
+    string path;                     // Chrome trace JSON written at exit
+    atomic<bool> enabled{false};
+    chrono::steady_clock::time_point epoch;
+    atomic<TraceBuffer*> buffers{nullptr};
+    atomic<uint32_t> next_tid{1};
+};
+
+// Times the enclosing scope; does nothing (beyond one load) while tracing is off
+struct TraceSpan {
+    const char* name = nullptr;      // nullptr: not recording
+    const char* category = nullptr;
+    chrono::steady_clock::time_point start;
+
+    TraceSpan(const char* span_name, const char* span_category);
+    ~TraceSpan();
+};
+
+// ---------- LOAD DRIVER ----------
+// Think-time distributions for simulated players
+enum ThinkTime {
+    THINK_NONE,                      // Answer immediately
+    THINK_FIXED,                     // Always a milliseconds
+    THINK_UNIFORM,                   // Uniform in [a, b] milliseconds
+    THINK_EXPONENTIAL                // Exponential with mean a milliseconds
+};
+
+// How the simulated players behave
+struct BotProfile {
+    double accuracy = 0.6;           // Chance of answering correctly
+    double lifeline_rate = 0.1;      // Chance per question of trying a random lifeline
+    int think = THINK_NONE;
+    double think_a = 0, think_b = 0;
+};
+
+// What one simulated player measured
+struct BotStats {
+    vector<float> action_us;         // Each engine call (tick, lifeline, answer)
+    vector<float> session_us;        // Engine time per session, think time excluded
+    vector<uint32_t> allocations;    // operator new calls per session
+    int64_t question_allocations = 0; // ... of them made between start() and finish()
+    int64_t sessions = 0;
+    int64_t correct = 0, wrong = 0, timeouts = 0, lifelines = 0;
+};
+
+// ---------- BENCHMARK SUITE ----------
+// One timed benchmark at one data size
+struct BenchResult {
+    string name;
+    int64_t rows;                    // Size of the synthetic bank / score file / queue
+    int64_t items;                   // Units timed (rows, sessions or queries)
+    double seconds;                  // Best of the repetitions
+};
+
+// ---------- SCORING SIMULATOR ----------
+const int simlanes = 1024;           // Simulated players, one lane each, played side by side
+
+// A simulated player population: accuracies spread evenly over [low, high]
+struct SkillModel {
+    const char* name;
+    double low;
+    double high;
+};
+
+// One cell of a sweep (rule set x skill model x difficulty) and what it measured
+struct SimCell {
+    int rules = 0;                   // Index into the rule grid
+    int model = 0;                   // Index into the skill models
+    int level = 1;                   // Difficulty, which picks the penalty
+    int min_score = 0;               // Score counted by histogram[0]
+    vector<int64_t> histogram;       // Sessions per final score
+    double top10_skilled = 0;        // Share of the leaderboard top 10 from the top skill decile
+    double rank_correlation = 0;     // Spearman correlation of leaderboard rank with skill rank
+};
+
+// ---------- FULL-TEXT SEARCH ----------
+const int searchresults = 20;        // Matches printed per query
+const int densepostings = 32;        // A term in 1 of this many questions or more is kept as a bitmap
+
+// Inverted index of one bank: every lower-cased word of a question and its options.
+// Terms are sorted, so a prefix query is one contiguous range of them. Rare terms
+// keep a list of question IDs; common ones a bitmap, which is smaller and intersects
+// a word at a time.
+struct TextIndex {
+    int questions = 0;               // Questions in the bank (bits per bitmap)
+    string terms;                    // Distinct terms in sorted order, back to back
+    vector<uint32_t> term_offsets;   // Start of term i in terms; the extra last entry is the end
+    vector<uint32_t> term_count;     // Questions containing term i
+    vector<uint64_t> term_start;     // Start of term i in postings, or in bitmaps if it is dense
+    vector<uint32_t> postings;       // Question IDs, ascending within each term
+    vector<uint64_t> bitmaps;        // One bit per question for each dense term
+};
+
+// Matches of one query word: a sorted ID list or a bitmap
+struct SearchTerm {
+    const uint32_t* ids = nullptr;
+    const uint64_t* bits = nullptr;  // Set for a bitmap
+    size_t count = 0;                // Matching questions
+};
+
+// ---------- NEAR-DUPLICATE DETECTION ----------
+const int stemhashes = 48;           // MinHash values over the words of a question's text
+const int optionhashes = 16;         // ... and over the words of its options
+const int minhashes = stemhashes + optionhashes;
+const int lshrows = 4;               // Signature values per LSH band
+const int lshbands = minhashes / lshrows;
+const double duplicatethreshold = 0.75; // Default similarity that counts as a near-duplicate
+const int duplicatesshown = 10;      // Clusters printed by --duplicates (the report has them all)
+
+// One question of a near-duplicate cluster
+struct DuplicateMember {
+    int bank = 0;                    // Index into the scanned banks
+    uint32_t id = 0;
+    double similarity = 1;           // Estimated similarity to the cluster's first question
+};
+
+// ---------- SCREEN RENDERER ----------
+// What the terminal shows, one string per row (tabs expanded, long lines wrapped)
+struct Screen {
+    vector<string> rows;             // Last frame sent to the terminal
+    vector<string> next;             // Frame being laid out (swapped with rows)
+    string out;                      // Escape sequences for one write
+    int known = 0;                   // Rows above the prompt; the rest may hold typed input
+    int width = 80;                  // Console window size in cells
+    int height = 25;
+    bool vt = false;                 // Console accepts ANSI escape sequences
+    bool valid = false;              // rows matches what is on screen
+};
 
 // ---------- GLOBAL VARIABLES ----------
-string filename;                     // Name of the current question file
-string questions[totalquestions];    // Array to store all loaded questions
-int indices[50];                     // Array of question indices for current difficulty
-int used_indices[50];                // Track which questions have been used
-int used_count = 0;                  // Count of used questions
-int score = 0;                       // Player's current score
 int category = 0;                    // Selected quiz category (1-5)
-int difficulty = 0;                  // Selected difficulty level (1-3)
+int difficulty = 0;                  // Selected difficulty level (1-3, or adaptivelevel)
 string playername;                   // Player's name
-int streak = 0;                      // Current streak of correct answers
-int timer = 15;                      // Default time limit per question (seconds)
-bool replace_requested = false;      // Flag for replace question lifeline
-
-// Lifeline availability flags
-bool lifeline_5050 = true;           // 50/50 lifeline (removes 2 wrong answers)
-bool lifeline_skip = true;           // Skip question lifeline (no penalty)
-bool lifeline_replace = true;        // Replace question lifeline (new question)
-bool lifeline_extratime = true;      // Extra time lifeline (+10 seconds)
-
-// Session tracking arrays for review feature
-string incorrect_questions[sessionquestions];           // Store incorrect questions
-string incorrect_options[sessionquestions][4];          // Store options for review
-int incorrect_correct_pos[sessionquestions];            // Store correct answer positions
-int incorrect_count = 0;             // Count of incorrect answers
-int correct_count = 0;               // Count of correct answers
-int wrong_count = 0;                 // Count of wrong answers
+BankSlot bank_cache[6];              // All category banks (1-5), loaded once and shared by every session
+atomic<bool> bank_watching(false);   // Keeps the bank watcher thread running
+double bank_load_ms = 0;             // How long load_bank_cache() took
+bool bank_indexing = false;          // Banks get a search index as they load (set by --search)
+atomic<bool> server_running(false);  // Cleared by Ctrl+C to stop the server
+Leaderboard leaderboard;             // Ranked high scores (filled on first use)
+mutex leaderboard_mutex;             // Guards leaderboard against server workers
+AsyncWriter writer;                  // Appends scores and logs off the game/server threads
+HistoryLoader history_loader;        // Reads histories for server STARTs off the event loops
+SeenStore history;                   // Questions each player has seen, per category
+RatingStore ratings;                 // Player and question ratings of adaptive sessions
+StatsStore question_stats;           // Lifetime counters of every question
+thread_local uint64_t* allocation_counter = nullptr; // Counts this thread's operator new calls while set
+Screen screen;                       // Console frame buffer
+ScoringRules scoring;                // Streak bonuses and negative marking of every session
+MetricsExporter metrics;             // Periodic Prometheus dump of the answer metrics
+atomic<ThreadMetrics*> metrics_threads(nullptr); // Registry of every thread's metrics block
+thread_local ThreadMetrics* thread_metrics = nullptr; // This thread's block, made by its first session start
+SessionTracer tracer;                // Span recording for --trace
+thread_local TraceBuffer* thread_trace = nullptr; // This thread's span ring, made when it is named
 
 // ---------- FUNCTION DECLARATIONS ----------
 
+// Opens (or creates) the history store name.idx/name.dat
+bool seen_store_open(SeenStore& store, string name);
 
- //Extracts and returns the substring before the first '|' delimiter
-
-string cut(string& s);
+/**
+ * Reads one key's seen set; empty if the key has no history
+ */
+bool seen_store_load(SeenStore& store, string_view key, SeenBitmap& bitmap);
 
-// Shuffles an array of integers using Fisher-Yates algorithm
+// Marks IDs seen under a key, rewriting its record in place while it fits
 
-void shuffle_array(int arr[], int n);
+void seen_store_add(SeenStore& store, string_view key, const vector<int>& ids);
 
-//Loads questions from a file into the global questions array
-int load_questions(string filename);
+/**
+ * Probes the index for a key; returns its slot (or the empty slot it would take)
+ * and sets record to its record offset + 1, or 0 if absent
+ */
+uint64_t seen_store_find(SeenStore& store, string_view key, uint64_t hash, uint64_t& record);
 
-// Displays a question with its options and handles user interaction
+// Doubles the index once it is 70% full
 
-void display_question(string question, string options[], int correct_pos, int q_num, bool is_review);
+void seen_store_grow(SeenStore& store);
 
 /**
- * Main quiz execution function - handles question flow and game logic
+ * History key for a player in a category
  */
-void start_quiz();
+string seen_key(string_view player, int cat);
 
-// Saves player's score to the high scores file
+// FNV-1a hash of a history key
 
-void save_high_score(string player, int score, string category, string difficulty);
+uint64_t hash_key(string_view key);
 
 /**
- * Displays the high scores leaderboard sorted by score
+ * Loads a player's seen questions for a category (queued updates are not waited for)
  */
-void show_high_scores();
+void load_seen_questions(string_view player, int cat, SeenBitmap& seen);
 
-// Gets user input with a countdown timer using non-blocking input
+// Queues a session's questions for the player's history
 
-bool get_answer_with_timer(int& answer, int time_limit);
+void record_seen_questions(string_view player, int cat, const int* ids, int count);
 
 /**
- * Updates the timer display in the top-right corner of console
+ * Opens (or creates) the rating table for the given banks (entries may be null),
+ * growing it for banks that have gained questions, and builds the pick index
  */
-void update_timer_display(int remaining);
+bool rating_store_open(RatingStore& store, string path, const QuestionBank* const banks[6]);
 
-// Activates 50/50 lifeline - removes 2 incorrect options
+// Flushes and unmaps the rating table
 
-void use_lifeline_5050(string options[], int correct_pos);
+void rating_store_close(RatingStore& store);
 
 /**
- * Activates skip question lifeline - skips current question without penalty
+ * Maps store.path read-write; false (and nothing mapped) unless it is a valid table
  */
-void use_lifeline_skip();
+bool rating_store_map(RatingStore& store);
 
-// Activates replace question lifeline - loads a new unused question
+// Unmaps the rating table without flushing it
 
-bool use_lifeline_replace(int& current_index, int used_indices[], int& used_count);
+void rating_store_unmap(RatingStore& store);
+
+/**
+ * Writes the table with a new layout, keeping every rating it holds (new questions
+ * start from their tag's prior), and maps the new file
+ */
+bool rating_store_rewrite(RatingStore& store, const uint32_t questions[6], uint32_t player_slots,
+    const QuestionBank* const banks[6]);
 
-// Activates extra time lifeline - adds 10 seconds to timer
+// Player's slot (the player's category lock held); add claims a new one, doubling the
+// table past half full, and needs every lock
 
-void use_lifeline_extratime(int& timer_ref);
+PlayerRating* find_player_rating(RatingStore& store, uint64_t key, bool add);
 
 /**
- * Resets all lifelines to available state at start of new quiz
+ * Rating table key of a player in a category (never 0)
  */
-void reset_lifelines();
+uint64_t rating_player_key(string_view player, int cat);
 
-// Gets current system date and time as formatted string
+// A player's rating in a category (ratingstart if unrated or the table is closed)
 
-string get_current_datetime();
+float player_rating(RatingStore& store, int cat, uint64_t player);
 
-// Saves detailed quiz session log to file
+/**
+ * Index order of a rating (1/16-point steps)
+ */
+uint64_t rating_order(float rating);
 
-void save_quiz_log(string player, string category_str, string difficulty_str, int correct, int wrong, int total_score);
+// Moves a rating toward an outcome (1 won, 0 lost) against an opponent's rating
+
+void update_rating(Rating& rating, float opponent, float outcome, float k_min, float k_max);
 
 /**
- * Displays all incorrectly answered questions for review
+ * Updates a registered player's and the question's ratings after an answer and
+ * moves the question within the index (unregistered players are left out)
  */
-void review_incorrect_questions();
+void rate_answer(RatingStore& store, int cat, int id, uint64_t player, bool correct);
+
+// One of the adaptivewindow questions rated nearest the player's target, skipping
+// excluded IDs and IDs from count up, and one the player has not seen (bit per ID in
+// seen) if the window holds any; -1 if the category has no ratings
+
+int pick_rated_question(RatingStore& store, int cat, uint64_t player, const int* exclude, int excluded,
+    uint64_t draw, int count, const uint64_t* seen = nullptr);
 
 /**
- * Displays post-quiz menu with options to review, replay, or exit
+ * Gives a player a rating slot before their session starts, so answers never add
+ * players or grow the table; false if the table is closed or cannot grow
  */
-void post_quiz_menu();
+bool register_rating_player(RatingStore& store, int cat, uint64_t key);
+
+// Adds ratings (and index entries) for questions a reloaded bank has gained; false if
+// the table is closed or cannot grow
+
+bool rating_store_extend(RatingStore& store, int cat, const QuestionBank& bank);
+
+// Opens (or creates) the statistics table for the given banks (entries may be null),
+// growing it for banks that have gained questions, and starts the sync thread
+
+bool stats_store_open(StatsStore& store, const QuestionBank* const banks[6]);
 
-// ======================= MAIN ============================
 /**
- * Main entry point - displays main menu and handles user navigation
+ * Maps store.path (read-only for reports); false (and nothing mapped) unless it is a valid table
  */
-int main() {
-    srand(time(0));  // Seed random number generator
+bool stats_store_map(StatsStore& store, bool writable = true);
 
-    while (true) {
-        system("cls");
-        cout << "========================================\n";
-        cout << "          CONSOLE-BASED QUIZ GAME\n";
-        cout << "========================================\n";
-        cout << "1. Start New Quiz\n";
-        cout << "2. View High Scores\n";
-        cout << "3. Exit\n";
-        cout << "Enter choice: ";
+// Unmaps the statistics table without flushing it
 
-        int choice;
-        cin >> choice;
-        cin.ignore();
+void stats_store_unmap(StatsStore& store);
 
-        if (choice == 3) break;  // Exit program
+/**
+ * Stops the sync thread, then flushes and unmaps the table
+ */
+void stats_store_close(StatsStore& store);
 
-        switch (choice) {
+// Flushes the mapped table every interval until stopped
 
-        case 1: {
-            // Get player information and quiz preferences
-            system("cls");
-            cout << "Enter your name: ";
-            getline(cin, playername);
+void stats_sync_loop(StatsStore& store);
 
-            // Category selection
-            cout << "=== SELECT CATEGORY ===\n";
-            cout << "1. Science\n2. Computer\n3. Sports\n4. History\n5. IQ/Logic\n";
-            cout << "Enter choice: ";
-            cin >> category;
-            cin.ignore();
+/**
+ * A question's counters; nullptr if the table is closed or does not hold the question
+ */
+QuestionStats* find_question_stats(StatsStore& store, int cat, int id);
 
-            // Validate category
-            if (category < 1 || category > 5) {
-                cout << "Invalid!\nPress Enter...";
-                cin.ignore();
-                break;
-            }
+// Counts how a question was closed (and the answer time of a correct or wrong answer)
 
-            // Difficulty selection
-            cout << "\n=== SELECT DIFFICULTY ===\n";
-            cout << "1. Easy\n2. Medium\n3. Hard\n";
-            cout << "Enter choice: ";
-            cin >> difficulty;
-            cin.ignore();
+void record_question_stats(StatsStore& store, int cat, int id, AnswerResult result, uint64_t latency_us);
 
-            // Validate difficulty
-            if (difficulty < 1 || difficulty > 3) {
-                cout << "Invalid!\nPress Enter...";
-                cin.ignore();
-                break;
-            }
+/**
+ * Prints the hardest and easiest questions (all categories, or one) from the table
+ */
+int run_question_stats(int count, int cat);
 
-            // Initialize quiz session variables
-            streak = 0;
-            timer = 15;
-            incorrect_count = 0;
-            correct_count = 0;
-            wrong_count = 0;
-            reset_lifelines();
-            start_quiz();
-            break;
-        }
+// Opens ratings.qrt and question_stats.qst for the cached banks / closes them
 
-        case 2:
-            // Display high scores
-            system("cls");
-            show_high_scores();
-            break;
+bool open_question_tables();
+void close_question_tables();
 
-        default:
-            cout << "Invalid choice. Press Enter...";
-            cin.ignore();
-        }
-    }
 
-    cout << "\nThank you for playing!\n";
-    return 0;
-}
+ //Extracts and returns the substring before the first '|' delimiter
+ //(no longer used by the game; kept as the tokenizer benchmark baseline)
 
-// ======================= FUNCTION DEFINITIONS ============================
+string cut(string& s);
 
-// ---------- Helper function to split string by '|' delimiter ----------
-string cut(string& s) {
-    int pos = s.find('|');
-    if (pos == string::npos) {
-        // No delimiter found, return entire string
-        string result = s;
-        s = "";
-        return result;
-    }
-    // Extract part before delimiter
-    string part = s.substr(0, pos);
-    // Update string to part after delimiter
-    s = s.substr(pos + 1);
-    return part;
-}
+// Splits a line into fields in one pass without allocating
+bool split_record(string_view line, char delim, Record& rec, int min_fields, int max_fields);
 
-// ---------- Shuffle array using Fisher-Yates algorithm ----------
-void shuffle_array(int arr[], int n) {
-    for (int i = n - 1; i > 0; i--) {
-        int j = rand() % (i + 1);
-        // Swap elements
-        int temp = arr[i];
-        arr[i] = arr[j];
-        arr[j] = temp;
-    }
-}
+/**
+ * Parses a whole field as an integer in [low, high]
+ */
+bool parse_field(string_view field, int low, int high, int& value);
 
-// ---------- Load questions from file ----------
-int load_questions(string filename) {
-    ifstream fin(filename);
-    if (!fin.is_open()) return 0;  // File not found
+// Splits and validates a question line, returning the correct option and tag
+bool parse_question_record(string_view line, Record& rec, int& correct, int& level);
 
-    int count = 0;
-    // Read questions line by line
-    while (getline(fin, questions[count]) && count < totalquestions) {
-        count++;
-    }
+/**
+ * Times cut() against split_record() on a synthetic bank
+ */
+void bench_tokenizer(int lines);
 
-    fin.close();
-    return count;  // Return number of questions loaded
-}
+// Runs every hot-path benchmark from 1K rows up to max_rows and writes JSON
 
-// ---------- Get current date and time as formatted string ----------
-string get_current_datetime() {
-    time_t now = time(0);
-    tm t;
+int run_bench_suite(string json_name, int64_t max_rows);
 
-    // Safe version of localtime
-    localtime_s(&t, &now);
+/**
+ * Synthetic bank / score file with the real files' shape
+ */
+void write_bench_bank(string name, int64_t rows);
+void write_bench_scores(string name, int64_t rows);
 
-    // Extract date and time components
-    int year = 1900 + t.tm_year;
-    int month = 1 + t.tm_mon;
-    int day = t.tm_mday;
-    int hour = t.tm_hour;
-    int minute = t.tm_min;
-    int second = t.tm_sec;
+// Best wall time of a number of runs, in seconds
 
-    char buffer[50];
+double time_best(int reps, const function<void()>& body);
 
-    // Format as string: YYYY-MM-DD HH:MM:SS
-    sprintf_s(buffer, "%04d-%02d-%02d %02d:%02d:%02d",
-        year, month, day, hour, minute, second);
+/**
+ * Records (and prints) one benchmark result
+ */
+void add_bench_result(vector<BenchResult>& results, string name, int64_t rows, int64_t items, double seconds);
 
-    return string(buffer);
-}
+// Writes results as JSON, with the checksum of everything the timed work read
 
-// ======================= TIMER FUNCTIONS ============================
+bool write_bench_json(string name, const vector<BenchResult>& results, long long checksum);
 
-// ---------- Update timer display at top right corner of console ----------
-void update_timer_display(int remaining) {
-    // Get console handle for cursor manipulation
-    HANDLE hConsole = GetStdHandle(STD_OUTPUT_HANDLE);
-    CONSOLE_SCREEN_BUFFER_INFO csbi;
-    GetConsoleScreenBufferInfo(hConsole, &csbi);
-    COORD origPos = csbi.dwCursorPosition;  // Save current cursor position
+// Shuffles an array of integers using Fisher-Yates algorithm
 
-    // Set cursor to top-right position
-    COORD timerPos;
-    timerPos.X = 60;
-    timerPos.Y = 0;
-    SetConsoleCursorPosition(hConsole, timerPos);
-    cout << "Time: " << remaining << "s ";
-    cout.flush();
+void shuffle_array(int arr[], int n, Pcg32& rng);
 
-    // Restore original cursor position
-    SetConsoleCursorPosition(hConsole, origPos);
-}
+/**
+ * A fresh, unpredictable session seed (never 0)
+ */
+uint64_t new_session_seed();
 
-// ---------- Get answer with countdown timer using non-blocking input ----------
-bool get_answer_with_timer(int& answer, int time_limit) {
-    auto start_time = chrono::steady_clock::now();
-    bool input_received = false;
+// Queues a finished session's seed and inputs for session_traces.txt
 
-    while (!input_received) {
-        // Calculate elapsed time
-        auto current_time = chrono::steady_clock::now();
-        auto elapsed = chrono::duration_cast<chrono::seconds>(current_time - start_time).count();
-        int remaining = time_limit - (int)elapsed;
+void save_session_trace(const QuizSession& session, string_view player, int cat, const SessionSummary& summary);
 
-        // Update timer display
-        if (remaining >= 0) {
-            update_timer_display(remaining);
-        }
+/**
+ * Replays recorded sessions (all, or those of one player or trace line number)
+ * and checks each reaches its recorded result; 0 if all match
+ */
+int run_replay(string file, string filter);
 
-        // Check if time expired
-        if (elapsed >= time_limit) {
-            cout << "\n\nTime's up!\n";
-            cin.clear();
-            cin.ignore(10000, '\n');
-            return false;
-        }
+// Loads (compiling if needed) a question file into the given bank
+int load_bank(QuestionBank& qb, string filename);
 
-        // Check for keyboard input (non-blocking)
-        if (_kbhit()) {
-            cin >> answer;
-            cin.clear();
-            cin.ignore(10000, '\n');
-            return true;
-        }
+/**
+ * Bank file, display name and difficulty name lookups
+ */
+string category_file(int cat);
+string category_name(int cat);
+string difficulty_name(int level);
 
-        // Sleep briefly to avoid busy-waiting
-        this_thread::sleep_for(chrono::milliseconds(100));
-    }
+// Compiles a pipe-delimited bank into the binary .qbk format; the line numbers of
+// malformed lines (left out) go to rejected if given
+bool compile_question_bank(string source, string target, vector<int>* rejected = nullptr);
 
-    return false;
-}
+/**
+ * ID of a string in a pool, adding it if it is new
+ */
+uint32_t intern_string(StringPool& pool, string_view text);
 
-// ======================= LIFELINE FUNCTIONS ============================
+/**
+ * Compiles a pipe-delimited bank into a .qbk image in memory; fails if the
+ * distinct text would pass 4 GB (the pool's offsets are 32-bit)
+ */
+bool build_bank_image(string source, string& image, vector<int>* rejected = nullptr);
 
-// ---------- Reset all lifelines to available state ----------
-void reset_lifelines() {
-    lifeline_5050 = true;
-    lifeline_skip = true;
-    lifeline_replace = true;
-    lifeline_extratime = true;
-}
+// Compiles a question file into a bank that owns its image instead of mapping the .qbk
+int reload_bank(QuestionBank& qb, string filename);
 
-// ---------- Lifeline 1: 50/50 - Remove 2 wrong answers ----------
-void use_lifeline_5050(string options[], int correct_pos) {
-    if (!lifeline_5050) {
-        cout << "\n[!] 50/50 already used!\n";
-        return;
-    }
+/**
+ * Checks a compiled bank of total bytes at qb.base and sets its offset table and count
+ */
+bool validate_question_bank(QuestionBank& qb, uint64_t total, string source);
 
-    lifeline_5050 = false;
-    cout << "\n[LIFELINE USED: 50/50]\n";
-    cout << "Removing 2 wrong answers...\n\n";
+/**
+ * Maps a compiled bank into memory, rejecting stale or corrupt files
+ */
+bool open_question_bank(QuestionBank& qb, string target, string source);
 
-    // Remove 2 incorrect options
-    int removed = 0;
-    for (int i = 0; i < 4 && removed < 2; ++i) {
-        if (i != correct_pos) {
-            options[i] = "[REMOVED]";
-            removed++;
-        }
-    }
-}
+// Unmaps a compiled bank, or frees one built in memory
+void close_question_bank(QuestionBank& qb);
 
-// ---------- Lifeline 2: Skip - Skip question without penalty ----------
-void use_lifeline_skip() {
-    if (!lifeline_skip) {
-        cout << "\n[!] Skip already used!\n";
-        return;
-    }
+/**
+ * Maps an existing, non-empty file read-write, or read-only alongside a process that
+ * has it mapped read-write; nullptr (handles closed) on failure
+ */
+char* map_whole_file(string path, bool writable, HANDLE& file, HANDLE& mapping, size_t& size);
 
-    lifeline_skip = false;
-    cout << "\n[LIFELINE USED: Skip Question]\n";
-    cout << "Question skipped without penalty!\n";
-}
+// Writes path.tmp and renames it over path
 
-// ---------- Lifeline 3: Replace - Get a new question ----------
-bool use_lifeline_replace(int& current_index, int used_indices[], int& used_count) {
-    if (!lifeline_replace) {
-        cout << "\n[!] Replace already used!\n";
-        return false;
-    }
+bool replace_file(string path, const vector<char>& contents);
 
-    lifeline_replace = false;
-    cout << "\n[LIFELINE USED: Replace Question]\n";
-    cout << "Finding a new question...\n\n";
+// Returns pointers to one question's text inside the mapped bank
+QuestionView get_question(const QuestionBank& qb, int id);
 
-    // Find an unused question from current difficulty range
-    int start_index = (difficulty - 1) * 50;
-    for (int i = start_index; i < start_index + 50; i++) {
-        bool is_used = false;
-        // Check if question already used
-        for (int j = 0; j < used_count; j++) {
-            if (used_indices[j] == i) {
-                is_used = true;
-                break;
-            }
-        }
-        // Found unused question
-        if (!is_used) {
-            current_index = i;
-            used_indices[used_count++] = i;
-            return true;
-        }
-    }
-    return false;  // No unused questions available
-}
+/**
+ * Buckets a bank's question IDs by difficulty tag
+ */
+void build_difficulty_index(QuestionBank& qb);
 
-// ---------- Lifeline 4: Extra Time - Add 10 seconds to timer ----------
-void use_lifeline_extratime(int& timer_ref) {
-    if (!lifeline_extratime) {
-        cout << "\nExtra Time already used!\n";
-        return;
-    }
+/**
+ * Publishes a bank as its category's snapshot; the old bank is freed with its last session
+ */
+void publish_bank(BankSlot& slot, shared_ptr<const QuestionBank> qb);
 
-    lifeline_extratime = false;
-    timer_ref += 10;  // Add 10 seconds
-    cout << "\n[LIFELINE USED: Extra Time]\n";
-    cout << "+10 seconds added! New time: " << timer_ref << "s\n";
-}
+// Current bank of a category (1-5), without taking a lock
 
-// ======================= LOGGING FUNCTIONS ============================
+shared_ptr<const QuestionBank> acquire_bank(int cat);
 
-// ---------- Save detailed quiz log to file ----------
-void save_quiz_log(string player, string category_str, string difficulty_str, int correct, int wrong, int total_score) {
-    ofstream fout("quiz_logs.txt", ios::app);  // Append mode
-    if (!fout.is_open()) {
-        cout << "Error opening quiz_logs.txt\n";
-        return;
-    }
+// Unmaps and deletes a published bank (the snapshots' deleter)
 
-    string datetime = get_current_datetime();
+void free_question_bank(const QuestionBank* qb);
 
-    // Write formatted log entry
-    fout << "========================================\n";
-    fout << "Player: " << player << "\n";
-    fout << "Date & Time: " <<__DATE__<<__TIME__<< "\n";
-    fout << "Category: " << category_str << "\n";
-    fout << "Difficulty: " << difficulty_str << "\n";
-    fout << "Questions Correct: " << correct << "\n";
-    fout << "Questions Wrong: " << wrong << "\n";
-    fout << "Total Score: " << total_score << "/" << sessionquestions << "\n";
-    fout << "========================================\n\n";
+/**
+ * Loads all five category banks on worker threads and publishes them;
+ * returns how many loaded
+ */
+int load_bank_cache();
 
-    fout.close();
-}
+// Drops every published bank
 
-// ======================= REVIEW FUNCTIONS ============================
+void release_bank_cache();
 
-// ---------- Review all incorrectly answered questions ----------
-void review_incorrect_questions() {
-    if (incorrect_count == 0) {
-        cout << "\nGreat job! You didn't answer any questions incorrectly!\n";
-        cout << "Press Enter to continue...";
-        cin.get();
-        return;
-    }
+/**
+ * Banks, questions, memory and load time of the cache, naming any missing bank
+ */
+string bank_cache_report();
 
-    system("cls");
-    cout << "========================================\n";
-    cout << "       REVIEWING INCORRECT ANSWERS\n";
-    cout << "========================================\n";
-    cout << "You answered " << incorrect_count << " question(s) incorrectly.\n\n";
-    cout << "Press Enter to review them...";
-    cin.get();
+// Reloads a category's bank if its text file changed (or has appeared) and the new bank is usable;
+// true if a new bank was published (verbose prints the outcome)
 
-    // Display each incorrect question with correct answer
-    for (int i = 0; i < incorrect_count; i++) {
-        system("cls");
-        cout << "Review Question " << i + 1 << " of " << incorrect_count << "\n\n";
+bool refresh_cached_bank(int cat, bool verbose);
 
-        // Display in review mode (no timer/lifelines)
-        display_question(incorrect_questions[i], incorrect_options[i], incorrect_correct_pos[i], 0, true);
-    }
+/**
+ * Watches the working directory and reloads edited banks while bank_watching is set
+ */
+void watch_question_banks(bool verbose);
 
-    cout << "\nReview complete!\n";
-    cout << "Press Enter to continue...";
-    cin.get();
-}
+// Negative marking for a difficulty level
 
-// ======================= QUESTION DISPLAY ============================
+int negative_mark(int level);
 
-// ---------- Display a question with options and handle user interaction ----------
-void display_question(string question, string options[], int correct_pos, int q_num, bool is_review = false) {
-    int map[4] = { 0,1,2,3 };  // Mapping array for shuffle tracking
-    int current_timer = timer;
+// Displays a question with its options and handles user interaction
 
-    // Create a copy of options for shuffling
-    string shuffled_options[4];
+void display_question(QuizSession& session, const PresentedQuestion& pq);
+
+/**
+ * Displays one incorrectly answered question (number of total) with its correct answer
+ */
+void display_review_question(const QuestionBank& qb, const ReviewItem& item, int number, int total);
+
+// Packs a displayed option order into a byte (2 bits per slot) and back
+
+uint8_t pack_permutation(const int order[4]);
+void unpack_permutation(uint8_t permutation, int order[4]);
+
+/**
+ * Main quiz execution function - handles question flow and game logic
+ */
+void start_quiz();
+
+// Saves player's score to the high scores file
+
+void save_high_score(string player, int score, string category, string difficulty);
+
+/**
+ * Displays the high scores leaderboard sorted by score
+ */
+void show_high_scores();
+
+// Reads high_scores.txt into the ranked leaderboard (first call only)
+
+void load_leaderboard(string name = "high_scores.txt");
+
+/**
+ * Adds one score to the leaderboard and all views it belongs to
+ */
+void add_leaderboard_entry(string player, int score, string category, string difficulty);
+
+// Leaderboard view index for a category (0-5) and difficulty (0-3), 0 = any
+
+int leaderboard_view(int cat, int level);
+
+/**
+ * Category (1-5) or difficulty (1-3) number from its display name, 0 if unknown
+ */
+int category_from_name(string_view name);
+int difficulty_from_name(string_view name);
+
+// Gets user input while ticking the session clock; false if time ran out
+
+bool get_answer_with_timer(QuizSession& session, int& answer, Feedback& timeout);
+
+/**
+ * Updates the timer display in the top-right corner of console
+ */
+void update_timer_display(int remaining);
+
+// Turns on ANSI escape processing for the console, if it supports it
+
+void screen_init();
+
+/**
+ * Shows a frame (text with '\n' line breaks), sending only the cells that
+ * differ from the previous frame in one write; the cursor ends after the last line
+ */
+void screen_present(const string& frame);
+
+// Splits a frame into screen rows, expanding tabs and wrapping long lines
+
+void screen_layout(const string& frame, vector<string>& rows, int width);
+
+/**
+ * Appends the escapes that turn one row of the previous frame into the new one
+ */
+void screen_diff_row(string& out, int row, const string& before, const string& after);
+
+// Overwrites part of the top row without moving the cursor
+
+void screen_status(int col, const string& text);
+
+// Discards queued console events that are not key presses
+
+void drain_console_events(HANDLE input);
+
+/**
+ * Current tick of the server timer wheels
+ */
+uint64_t current_tick();
+
+// Gets current system date and time as formatted string
+
+string get_current_datetime();
+
+/**
+ * Formats a Unix time as local "YYYY-MM-DD HH:MM:SS"
+ */
+string format_datetime(int64_t when);
+
+// "YYYY-MM-DD" for a count of days since 1970-01-01
+
+string format_day(int64_t day);
+
+// Saves detailed quiz session log to file
+
+void save_quiz_log(string player, string category_str, string difficulty_str, int correct, int wrong, int total_score,
+    uint32_t outcomes);
+
+/**
+ * Appends sessions to a buffer as one session log block
+ */
+void encode_log_block(const vector<SessionRow>& rows, string& out);
+
+// Checks one block at the start of data and points cols at its columns
+
+bool decode_log_block(const char* data, uint64_t available, LogColumns& cols);
+
+/**
+ * Player names of a decoded block, indexed like its player column
+ */
+void log_block_names(const LogColumns& cols, vector<string_view>& names);
+
+/**
+ * Maps a session log read-only; false if it is missing or empty
+ */
+bool map_session_log(string name, HANDLE& file, HANDLE& mapping, const char*& base, uint64_t& size);
+void unmap_session_log(HANDLE file, HANDLE mapping, const char* base);
+
+// Unix time from "YYYY-MM-DD HH:MM:SS" or the old "Mmm dd yyyyhh:mm:ss" (local time)
+
+bool parse_log_datetime(string_view text, int64_t& time);
+
+/**
+ * Converts the old text log (quiz_logs.txt) to session log blocks
+ */
+int run_log_import(string source, string target);
+
+// Group-by/aggregate report over the session log, e.g. keys "category,day"
+
+int run_log_query(string keys, string name);
+
+/**
+ * Prints every session in the log in the old text format
+ */
+int run_log_dump(string name);
+
+/**
+ * Displays all incorrectly answered questions for review
+ */
+void review_incorrect_questions(const QuizSession& session);
+
+// Queues text for appending to a file; never blocks on disk
+
+void writer_enqueue(WriterFile file, string text);
+
+/**
+ * Queues a finished session for the session log
+ */
+void writer_enqueue_session(SessionRow row);
+
+// Pushes a record onto the writer queue (any thread)
+
+void writer_push(WriteRecord* rec);
+
+/**
+ * Starts / drains and stops the background writer thread
+ */
+void writer_start();
+void writer_stop();
+
+// Waits until everything queued so far is on disk (in the OS cache)
+
+void writer_sync();
+
+/**
+ * Background writer loop: group-commits the queue every flush interval
+ */
+void writer_loop();
+
+// Appends every record currently in the queue, one write per file; returns records written
+
+int writer_commit();
+
+/**
+ * Takes the oldest queued record (writer side only), nullptr if none is ready
+ */
+WriteRecord* writer_pop();
+
+// This thread's metrics block, registered on first use
+
+ThreadMetrics& local_metrics();
+
+/**
+ * Adds to a counter that only the calling thread writes
+ */
+void metric_add(atomic<uint64_t>& counter, uint64_t amount);
+
+// Latency histogram bucket of a value in microseconds, and the smallest value in a bucket
+
+int latency_bucket(uint64_t us);
+uint64_t latency_bucket_floor(int bucket);
+
+/**
+ * Records how a question of a category (1-5) was closed and, if answered, how long it took
+ */
+void record_question_metrics(int cat, AnswerResult result, uint64_t latency_us);
+
+// Records a used lifeline (5-8) or a finished session of a category
+
+void record_lifeline_metric(int cat, int lifeline);
+void record_session_metric(int cat);
+
+/**
+ * Sums every thread's metrics
+ */
+void merge_metrics(MetricsSnapshot& total);
+
+// The metrics in Prometheus text format
+
+string metrics_text();
+
+/**
+ * Writes the metrics file (metrics.path) in one rename
+ */
+bool write_metrics_file();
+
+// Starts / stops the thread that dumps the metrics every interval (and once on stop)
+
+void metrics_start();
+void metrics_stop();
+void metrics_loop();
+
+// This thread's span ring, registered on first use
+
+TraceBuffer* local_trace_buffer();
+
+/**
+ * Names the calling thread on the trace timeline (if tracing is on)
+ */
+void trace_thread_name(const char* name);
+
+// Turns tracing on; the trace is written to path when the program exits
+
+void trace_start(string path);
+
+/**
+ * Writes every thread's spans as Chrome trace JSON (once)
+ */
+bool write_trace_file();
+
+/**
+ * Displays post-quiz menu with options to review, replay, or exit
+ */
+void post_quiz_menu(const QuizSession& session);
+
+// Runs the multi-session quiz server until Ctrl+C
+
+int run_server(int port, int workers);
+
+/**
+ * One server worker: polls its connections and the shared listening socket
+ */
+void server_worker(SOCKET listener);
+
+// Handles one protocol line from a client
+
+void handle_client_line(ClientConnection& client, string_view line);
+
+/**
+ * Queues the open question (or the session end) for a client
+ */
+void send_next_question(ClientConnection& client);
+
+// Handles a client's complete lines, stopping while a START waits for its history
+
+void handle_client_lines(ClientConnection& client);
+
+/**
+ * Starts the session of a START whose history has arrived
+ */
+void finish_client_start(ClientConnection& client);
+
+// Starts / stops the history loader thread, and queues a load for it
+
+void history_loader_start();
+void history_loader_stop();
+void history_loader_loop();
+void queue_history_load(shared_ptr<HistoryLoad> load);
+
+// Queues the result of an answer, lifeline or timeout
+
+void send_feedback(ClientConnection& client, const Feedback& fb);
+
+/**
+ * Plays bot sessions against a running server and reports throughput/latency
+ */
+int run_server_load(int port, int clients, int sessions);
+
+// Runs simulated players against the session engine in parallel and reports
+// throughput, latency percentiles and allocations per session
+
+int run_load_driver(int players, int sessions, const BotProfile& profile);
+
+/**
+ * One simulated player's sessions
+ */
+void bot_player(int id, int sessions, const BotProfile& profile, BotStats& stats);
+
+// Heap block behind every operator new form; counted while allocation_counter is set
+
+void* counted_allocate(size_t size, size_t alignment);
+
+/**
+ * Releases a block from counted_allocate
+ */
+void counted_free(void* p, size_t alignment);
+
+// Parses "none", "fixed:<ms>", "uniform:<lo>-<hi>" or "exp:<mean ms>"
+
+bool parse_think_time(string_view spec, BotProfile& profile);
+
+/**
+ * Draws one think time in milliseconds
+ */
+double draw_think_ms(const BotProfile& profile, mt19937& rng);
+
+// Builds a bank's inverted index (question and option text)
+
+void build_text_index(const QuestionBank& qb, TextIndex& index);
+
+/**
+ * Attaches a search index to a bank about to be published, if bank_indexing is set
+ */
+void index_bank(QuestionBank& qb);
+
+/**
+ * Next lower-cased word (letters and digits) of text from pos; false at the end
+ */
+bool next_search_token(string_view text, size_t& pos, string& token);
+
+// Questions matching every word of a query ("word*" matches any word with that prefix):
+// the first limit IDs in order, and how many match in all
+
+size_t search_text_index(const TextIndex& index, string_view query, vector<uint32_t>& ids, size_t limit);
+
+/**
+ * Matches of one term, or of every term with a prefix (merged into scratch)
+ */
+SearchTerm search_term(const TextIndex& index, string_view term, bool prefix, vector<uint32_t>& scratch_ids,
+    vector<uint64_t>& scratch_bits);
+
+// Keeps the IDs of acc that are also in list, galloping through the longer list
+
+void intersect_postings(vector<uint32_t>& acc, const uint32_t* list, size_t count);
+
+/**
+ * Searches the banks for a query (all categories, or one), or reads queries
+ * from the console when the query is empty
+ */
+int run_search(string query, int cat);
+
+// Fills minhashes signature values per question of a bank (stemhashes over its
+// text, optionhashes over its options), using every core
+
+void minhash_bank(const QuestionBank& qb, uint32_t* signatures);
+
+/**
+ * Share of equal values in two signatures: estimates their similarity (0-1)
+ */
+double signature_similarity(const uint32_t* a, const uint32_t* b);
+
+// Groups near-duplicate questions within and across banks, largest cluster first;
+// returns the candidate pairs compared
+
+size_t find_duplicate_clusters(const vector<const QuestionBank*>& banks, double threshold,
+    vector<vector<DuplicateMember>>& clusters);
+
+/**
+ * splitmix64 finalizer: spreads a hash over all 64 bits
+ */
+uint64_t mix_hash(uint64_t x);
+
+// Reports near-duplicate clusters across the five banks, every cluster to a report file
+
+int run_duplicates(double threshold, string report_name);
+
+// Plays synthetic sessions for every rule set x skill model x difficulty on all
+// cores and writes score distributions and leaderboard skew as JSON
+
+int run_simulator(int64_t sessions, int threads, string json_name);
+
+/**
+ * Rule sets swept by the simulator (the current rules are one of them)
+ */
+vector<ScoringRules> scoring_rule_grid();
+
+// Plays rounds of simlanes sessions, one per simulated player, for one cell
+
+void simulate_cell(SimCell& cell, const ScoringRules& rules, const SkillModel& model, int64_t rounds, uint64_t seed);
+
+/**
+ * Mean, standard deviation and skewness of a cell's scores
+ */
+void histogram_moments(const SimCell& cell, double& mean, double& stddev, double& skew);
+
+// Score at a fraction (0-1) of a cell's sessions
+
+int histogram_percentile(const SimCell& cell, double fraction);
+
+/**
+ * Writes every cell of a sweep as JSON
+ */
+bool write_simulation_json(string name, const vector<SimCell>& cells, const vector<ScoringRules>& grid,
+    const SkillModel* models, int64_t rounds, double seconds);
+
+// Plays sessions at every category and difficulty, with and without history, using
+// every lifeline and letting questions time out; fails (1) if any operator new call
+// happens between start() and the end of finish()
+
+int run_allocation_check(int sessions);
+
+// ======================= MAIN ============================
+/**
+ * Main entry point - displays main menu and handles user navigation
+ */
+int main(int argc, char* argv[]) {
+    // Writer options may appear anywhere; the rest pick the mode
+    vector<string> args;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--flush-ms" && i + 1 < argc) {
+            writer.flush_ms = atoi(argv[++i]);
+        } else if (arg == "--fsync" && i + 1 < argc) {
+            writer.fsync_commits = string(argv[++i]) == "commit";
+        } else if (arg == "--metrics" && i + 1 < argc) {
+            metrics.path = argv[++i];
+            if (metrics.path == "off") metrics.path.clear();
+        } else if (arg == "--metrics-ms" && i + 1 < argc) {
+            metrics.interval_ms = atoi(argv[++i]);
+        } else if (arg == "--stats-ms" && i + 1 < argc) {
+            question_stats.interval_ms = atoi(argv[++i]);
+        } else if (arg == "--trace" && i + 1 < argc) {
+            trace_start(argv[++i]);
+        } else {
+            args.push_back(arg);
+        }
+    }
+    int nargs = (int)args.size();
+
+    // Command line tools
+    if (nargs >= 2 && args[0] == "--compile") {
+        string source = args[1];
+        string target = nargs >= 3 ? args[2] : source.substr(0, source.rfind('.')) + ".qbk";
+        vector<int> rejected;
+        if (!compile_question_bank(source, target, &rejected)) {
+            cout << "Failed to compile " << source << "\n";
+            return 1;
+        }
+        cout << "Compiled " << source << " -> " << target << "\n";
+        if (!rejected.empty()) {
+            cout << "Skipped " << rejected.size() << " malformed line(s):";
+            for (size_t i = 0; i < rejected.size() && i < 50; i++) cout << " " << rejected[i];
+            cout << (rejected.size() > 50 ? " ...\n" : "\n");
+        }
+
+        // Near-duplicates within the new bank are flagged as it comes in
+        QuestionBank qb;
+        if (open_question_bank(qb, target, source)) {
+            vector<vector<DuplicateMember>> clusters;
+            find_duplicate_clusters({ &qb }, duplicatethreshold, clusters);
+            size_t questions = 0;
+            for (const auto& cluster : clusters) questions += cluster.size();
+            if (!clusters.empty()) {
+                cout << clusters.size() << " near-duplicate cluster(s) covering " << questions <<
+                    " questions; --duplicates lists them\n";
+            }
+            close_question_bank(qb);
+        }
+        return 0;
+    }
+    if (nargs >= 1 && args[0] == "--bench-tokenizer") {
+        bench_tokenizer(nargs >= 2 ? atoi(args[1].c_str()) : 1000000);
+        return 0;
+    }
+    if (nargs >= 1 && args[0] == "--bench") {
+        return run_bench_suite(nargs >= 2 ? args[1] : "bench.json", nargs >= 3 ? atoll(args[2].c_str()) : 1000000);
+    }
+    if (nargs >= 1 && args[0] == "--loadtest") {
+        BotProfile profile;
+        if (nargs >= 4) profile.accuracy = atof(args[3].c_str());
+        if (nargs >= 5 && !parse_think_time(args[4], profile)) {
+            cout << "Think time: none, fixed:<ms>, uniform:<lo>-<hi> or exp:<mean ms>\n";
+            return 1;
+        }
+        if (nargs >= 6) profile.lifeline_rate = atof(args[5].c_str());
+        return run_load_driver(nargs >= 2 ? atoi(args[1].c_str()) : 8, nargs >= 3 ? atoi(args[2].c_str()) : 10000,
+            profile);
+    }
+    if (nargs >= 1 && args[0] == "--check-allocations") {
+        return run_allocation_check(nargs >= 2 ? atoi(args[1].c_str()) : 200);
+    }
+    if (nargs >= 1 && args[0] == "--search") {
+        return run_search(nargs >= 2 ? args[1] : "", nargs >= 3 ? atoi(args[2].c_str()) : 0);
+    }
+    if (nargs >= 1 && args[0] == "--duplicates") {
+        return run_duplicates(nargs >= 2 ? atof(args[1].c_str()) : duplicatethreshold,
+            nargs >= 3 ? args[2] : "duplicates.txt");
+    }
+    if (nargs >= 1 && args[0] == "--question-stats") {
+        return run_question_stats(nargs >= 2 ? atoi(args[1].c_str()) : 10, nargs >= 3 ? atoi(args[2].c_str()) : 0);
+    }
+    if (nargs >= 1 && args[0] == "--simulate") {
+        return run_simulator(nargs >= 2 ? atoll(args[1].c_str()) : 1048576,
+            nargs >= 3 ? atoi(args[2].c_str()) : (int)thread::hardware_concurrency(), nargs >= 4 ? args[3] : "simulation.json");
+    }
+    if (nargs >= 1 && args[0] == "--logquery") {
+        return run_log_query(nargs >= 2 ? args[1] : "category,day", nargs >= 3 ? args[2] : "quiz_logs.qcl");
+    }
+    if (nargs >= 1 && args[0] == "--logimport") {
+        return run_log_import(nargs >= 2 ? args[1] : "quiz_logs.txt", nargs >= 3 ? args[2] : "quiz_logs.qcl");
+    }
+    if (nargs >= 1 && args[0] == "--replay") {
+        return run_replay(nargs >= 2 ? args[1] : "session_traces.txt", nargs >= 3 ? args[2] : "");
+    }
+    if (nargs >= 1 && args[0] == "--logdump") {
+        return run_log_dump(nargs >= 2 ? args[1] : "quiz_logs.qcl");
+    }
+    if (nargs >= 1 && args[0] == "--server") {
+        return run_server(nargs >= 2 ? atoi(args[1].c_str()) : 5050, nargs >= 3 ? atoi(args[2].c_str()) : 4);
+    }
+    if (nargs >= 1 && args[0] == "--server-load") {
+        return run_server_load(nargs >= 2 ? atoi(args[1].c_str()) : 5050, nargs >= 3 ? atoi(args[2].c_str()) : 16,
+            nargs >= 4 ? atoi(args[3].c_str()) : 1000);
+    }
+
+    writer_start();  // Scores and logs are appended in the background
+    metrics_start();
+    seen_store_open(history, "seen_history");
+
+    // Every bank is loaded once; starting or replaying a quiz never touches the disk
+    load_bank_cache();
+    open_question_tables();
+    string banks = "Question banks: " + bank_cache_report() + "\n\n";
+    bank_watching = true;
+    thread watcher(watch_question_banks, false);  // Picks up edited bank files
+    screen_init();   // Screens are drawn as frames from here on
+
+    while (true) {
+        screen_present(
+            "========================================\n"
+            "          CONSOLE-BASED QUIZ GAME\n"
+            "========================================\n" + banks +
+            "1. Start New Quiz\n"
+            "2. View High Scores\n"
+            "3. Exit\n"
+            "Enter choice: ");
+
+        int choice;
+        cin >> choice;
+        cin.ignore();
+
+        if (choice == 3) break;  // Exit program
+
+        switch (choice) {
+
+        case 1: {
+            // Get player information and quiz preferences
+            screen_present("Enter your name: ");
+            getline(cin, playername);
+
+            // Category selection
+            screen_present(
+                "=== SELECT CATEGORY ===\n"
+                "1. Science\n2. Computer\n3. Sports\n4. History\n5. IQ/Logic\n"
+                "Enter choice: ");
+            cin >> category;
+            cin.ignore();
+
+            // Validate category
+            if (category < 1 || category > 5) {
+                screen_present("Invalid!\nPress Enter...");
+                cin.ignore();
+                break;
+            }
+
+            // Difficulty selection
+            screen_present(
+                "=== SELECT DIFFICULTY ===\n"
+                "1. Easy\n2. Medium\n3. Hard\n"
+                "4. Adaptive (your rating: " +
+                to_string((int)player_rating(ratings, category, rating_player_key(playername, category))) + ")\n"
+                "Enter choice: ");
+            cin >> difficulty;
+            cin.ignore();
+
+            // Validate difficulty
+            if (difficulty < 1 || difficulty > adaptivelevel) {
+                screen_present("Invalid!\nPress Enter...");
+                cin.ignore();
+                break;
+            }
+
+            start_quiz();
+            break;
+        }
+
+        case 2:
+            // Display high scores
+            show_high_scores();
+            break;
+
+        default:
+            screen_present("Invalid choice. Press Enter...");
+            cin.ignore();
+        }
+    }
+
+    writer_stop();  // Drain queued scores/logs before exiting
+    metrics_stop();
+    bank_watching = false;
+    watcher.join();
+    close_question_tables();
+    release_bank_cache();
+    cout << "\nThank you for playing!\n";
+    return 0;
+}
+
+// ======================= FUNCTION DEFINITIONS ============================
+
+// ---------- Helper function to split string by '|' delimiter ----------
+string cut(string& s) {
+    int pos = s.find('|');
+    if (pos == string::npos) {
+        // No delimiter found, return entire string
+        string result = s;
+        s = "";
+        return result;
+    }
+    // Extract part before delimiter
+    string part = s.substr(0, pos);
+    // Update string to part after delimiter
+    s = s.substr(pos + 1);
+    return part;
+}
+
+// ---------- Split a delimited line into fields ----------
+bool split_record(string_view line, char delim, Record& rec, int min_fields, int max_fields) {
+    // Banks are saved with Windows line endings
+    if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+
+    rec.count = 0;
+    size_t start = 0;
+    while (true) {
+        size_t pos = line.find(delim, start);
+        if (rec.count == max_fields) return false;  // Too many fields
+        if (pos == string_view::npos) {
+            rec.fields[rec.count++] = line.substr(start);
+            break;
+        }
+        rec.fields[rec.count++] = line.substr(start, pos - start);
+        start = pos + 1;
+    }
+    return rec.count >= min_fields;
+}
+
+// ---------- Parse an integer field with range check ----------
+bool parse_field(string_view field, int low, int high, int& value) {
+    const char* first = field.data();
+    const char* last = first + field.size();
+    auto result = from_chars(first, last, value);
+    return result.ec == errc() && result.ptr == last && value >= low && value <= high;
+}
+
+// ---------- Split and validate a question line ----------
+bool parse_question_record(string_view line, Record& rec, int& correct, int& level) {
+    // Question|Option1|Option2|Option3|Option4|CorrectAnswerNumber[|DifficultyTag]
+    if (!split_record(line, '|', rec, 6, 7)) return false;
+    if (rec.fields[0].empty() || !parse_field(rec.fields[5], 1, 4, correct)) return false;
+    level = 1;
+    if (rec.count == 7 && !parse_field(rec.fields[6], 1, 3, level)) return false;
+    return true;
+}
+
+// ---------- Benchmark: cut() vs split_record() ----------
+void bench_tokenizer(int lines) {
+    if (lines <= 0) lines = 1000000;
+
+    // Synthetic bank shaped like the real files
+    vector<string> bank_lines(lines);
+    for (int i = 0; i < lines; i++) {
+        bank_lines[i] = "Which of these is question number " + to_string(i) +
+            "?|Keyboard|Monitor|CPU|Printer|" + to_string(i % 4 + 1) + "|" + to_string(i % 3 + 1);
+    }
+
+    long long checksum_old = 0, checksum_new = 0;
+
+    auto t0 = chrono::steady_clock::now();
+    for (int i = 0; i < lines; i++) {
+        string line = bank_lines[i];
+        string question = cut(line);
+        string a = cut(line), b = cut(line), c = cut(line), d = cut(line);
+        string correct_str = cut(line);
+        string tag = cut(line);
+        checksum_old += question.size() + a.size() + d.size() + stoi(correct_str) + stoi(tag);
+    }
+    auto t1 = chrono::steady_clock::now();
+
+    Record rec;
+    for (int i = 0; i < lines; i++) {
+        int correct, level;
+        if (!parse_question_record(bank_lines[i], rec, correct, level)) continue;
+        checksum_new += rec.fields[0].size() + rec.fields[1].size() + rec.fields[4].size() + correct + level;
+    }
+    auto t2 = chrono::steady_clock::now();
+
+    double old_ms = chrono::duration<double, milli>(t1 - t0).count();
+    double new_ms = chrono::duration<double, milli>(t2 - t1).count();
+
+    cout << "Lines parsed:     " << lines << "\n";
+    cout << "cut():            " << old_ms << " ms (" << old_ms * 1e6 / lines << " ns/line)\n";
+    cout << "split_record():   " << new_ms << " ms (" << new_ms * 1e6 / lines << " ns/line)\n";
+    cout << "Speedup:          " << (new_ms > 0 ? old_ms / new_ms : 0) << "x\n";
+    if (checksum_old != checksum_new) cout << "WARNING: results differ!\n";
+}
+
+// ---------- Shuffle array using Fisher-Yates algorithm ----------
+void shuffle_array(int arr[], int n, Pcg32& rng) {
+    for (int i = n - 1; i > 0; i--) {
+        int j = (int)rng.below((uint32_t)i + 1);
+        // Swap elements
+        int temp = arr[i];
+        arr[i] = arr[j];
+        arr[j] = temp;
+    }
+}
+
+// ---------- Seed a PCG32 generator ----------
+void Pcg32::seed(uint64_t seed, uint64_t stream) {
+    state = 0;
+    inc = (stream << 1) | 1;
+    next();
+    state += seed;
+    next();
+}
+
+// ---------- Next 32 random bits ----------
+uint32_t Pcg32::next() {
+    uint64_t old = state;
+    state = old * 6364136223846793005ull + inc;
+    uint32_t xorshifted = (uint32_t)(((old >> 18) ^ old) >> 27);
+    uint32_t rot = (uint32_t)(old >> 59);
+    return (xorshifted >> rot) | (xorshifted << ((32 - rot) & 31));
+}
+
+// ---------- Uniform integer below a bound ----------
+uint32_t Pcg32::below(uint32_t bound) {
+    // Lemire's multiply-shift; the few products that would favour some results are redrawn
+    uint64_t m = (uint64_t)next() * bound;
+    uint32_t low = (uint32_t)m;
+    if (low < bound) {
+        uint32_t threshold = (0u - bound) % bound;
+        while (low < threshold) {
+            m = (uint64_t)next() * bound;
+            low = (uint32_t)m;
+        }
+    }
+    return (uint32_t)(m >> 32);
+}
+
+// ---------- Draw a session seed ----------
+uint64_t new_session_seed() {
+    // splitmix64 over a random per-process base and a counter: distinct seeds from any thread
+    static const uint64_t base = ((uint64_t)random_device()() << 32 | random_device()()) ^
+        (uint64_t)chrono::steady_clock::now().time_since_epoch().count();
+    static atomic<uint64_t> counter(0);
+    uint64_t z = base + (counter.fetch_add(1) + 1) * 0x9e3779b97f4a7c15ull;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    z ^= z >> 31;
+    return z != 0 ? z : 1;
+}
+
+// ---------- Load a question file into a bank ----------
+int load_bank(QuestionBank& qb, string filename) {
+    TraceSpan span("load_bank", "bank");
+    string target = filename.substr(0, filename.rfind('.')) + ".qbk";
+
+    // Unmap first: a mapped file cannot be rewritten on Windows
+    close_question_bank(qb);
+
+    // Use the compiled bank if it is up to date, otherwise rebuild it
+    if (!open_question_bank(qb, target, filename)) {
+        if (!compile_question_bank(filename, target)) return 0;  // File not found
+        if (!open_question_bank(qb, target, filename)) return 0;
+    }
+    build_difficulty_index(qb);
+    return qb.count;
+}
+
+// ---------- Compile a question file into a bank held in memory ----------
+int reload_bank(QuestionBank& qb, string filename) {
+    TraceSpan span("reload_bank", "bank");
+    // The .qbk may still be mapped by sessions on the old bank, so it is left
+    // alone; the next cold start sees it is stale and rebuilds it
+    close_question_bank(qb);
+    if (!build_bank_image(filename, qb.image)) return 0;
+    qb.base = qb.image.data();
+    if (qb.image.size() < sizeof(BankHeader) || !validate_question_bank(qb, qb.image.size(), filename)) {
+        close_question_bank(qb);
+        return 0;
+    }
+    build_difficulty_index(qb);
+    return qb.count;
+}
+
+// ---------- Category and difficulty names ----------
+string category_file(int cat) {
+    switch (cat) {
+    case 1: return "science.txt";
+    case 2: return "computer.txt";
+    case 3: return "sports.txt";
+    case 4: return "history.txt";
+    case 5: return "iq.txt";
+    }
+    return "";
+}
+
+string category_name(int cat) {
+    return (cat == 1 ? "Science" :
+        cat == 2 ? "Computer" :
+        cat == 3 ? "Sports" :
+        cat == 4 ? "History" : "IQ");
+}
+
+string difficulty_name(int level) {
+    return (level == 1 ? "Easy" :
+        level == 2 ? "Medium" : level == adaptivelevel ? "Adaptive" : "Hard");
+}
+
+// ---------- Group question IDs by their difficulty tag ----------
+void build_difficulty_index(QuestionBank& qb) {
+    for (int d = 0; d < 4; d++) qb.pool[d].clear();
+
+    // Only the fixed record header is touched, the text is never read
+    for (int id = 0; id < qb.count; id++) {
+        const BankRecord& rec = qb.records[id];
+        if (rec.difficulty >= 1 && rec.difficulty <= 3) {
+            qb.pool[rec.difficulty].push_back(id);
+        }
+    }
+}
+
+// ======================= QUESTION BANK ============================
+
+// ---------- Read size and last write time of a file ----------
+bool get_file_stamp(string path, uint64_t& size, uint64_t& time) {
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if (!GetFileAttributesExA(path.c_str(), GetFileExInfoStandard, &data)) return false;
+    size = ((uint64_t)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+    time = ((uint64_t)data.ftLastWriteTime.dwHighDateTime << 32) | data.ftLastWriteTime.dwLowDateTime;
+    return true;
+}
+
+// ---------- Map a whole file ----------
+char* map_whole_file(string path, bool writable, HANDLE& file, HANDLE& mapping, size_t& size) {
+    // The writer lets others read; a reader lets the writer keep writing (and replace the file)
+    file = writable ?
+        CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+            FILE_ATTRIBUTE_NORMAL, NULL) :
+        CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL,
+            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    mapping = NULL;
+    if (file == INVALID_HANDLE_VALUE) return nullptr;
+
+    LARGE_INTEGER length;
+    char* base = nullptr;
+    if (GetFileSizeEx(file, &length) && length.QuadPart > 0 &&
+        (mapping = CreateFileMappingA(file, NULL, writable ? PAGE_READWRITE : PAGE_READONLY, 0, 0, NULL)) != NULL) {
+        base = (char*)MapViewOfFile(mapping, writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, 0);
+    }
+    if (base == nullptr) {
+        if (mapping != NULL) CloseHandle(mapping);
+        CloseHandle(file);
+        file = INVALID_HANDLE_VALUE;
+        mapping = NULL;
+        return nullptr;
+    }
+    size = (size_t)length.QuadPart;
+    return base;
+}
+
+// ---------- Replace a file in one rename ----------
+bool replace_file(string path, const vector<char>& contents) {
+    // Written aside first, so a crash leaves the old file or the new one
+    string temp = path + ".tmp";
+    ofstream fout(temp, ios::binary | ios::trunc);
+    fout.write(contents.data(), contents.size());
+    fout.close();
+    return !fout.fail() && MoveFileExA(temp.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+}
+
+// ---------- Compile a text bank into the binary format ----------
+bool compile_question_bank(string source, string target, vector<int>* rejected) {
+    string image;
+    if (!build_bank_image(source, image, rejected)) return false;
+
+    ofstream fout(target, ios::binary | ios::trunc);
+    if (!fout.is_open()) return false;
+    fout.write(image.data(), image.size());
+    fout.close();
+    return !fout.fail();
+}
+
+// ---------- Compile a text bank in memory ----------
+bool build_bank_image(string source, string& image, vector<int>* rejected) {
+    uint64_t source_size, source_time;
+    if (!get_file_stamp(source, source_size, source_time)) return false;
+
+    ifstream fin(source);
+    if (!fin.is_open()) return false;
+
+    vector<BankRecord> records;
+    StringPool pool;
+    pool.slots.assign(1024, 0);
+
+    string line;
+    Record fields;
+    int line_number = 0;
+    uint32_t skipped = 0;
+    if (rejected != nullptr) rejected->clear();
+    while (getline(fin, line)) {
+        // Leave malformed lines out instead of failing at quiz time, but count them
+        // so a typo does not make questions vanish unnoticed (blank lines are fine)
+        line_number++;
+        int correct, level;
+        if (!parse_question_record(line, fields, correct, level)) {
+            if (line.find_first_not_of(" \t\r") == string::npos) continue;
+            skipped++;
+            if (rejected != nullptr) rejected->push_back(line_number);
+            continue;
+        }
+
+        // Pool offsets are 32-bit; a bank that would overflow them is not compiled
+        // at all, rather than quietly losing its remaining questions
+        if (pool.bytes.size() + line.size() > UINT32_MAX) return false;
+
+        BankRecord rec;
+        rec.correct = (uint8_t)(correct - 1);
+        rec.difficulty = (uint8_t)level;
+        rec.reserved = 0;
+        for (int i = 0; i < 5; i++) rec.text[i] = intern_string(pool, fields.fields[i]);
+        records.push_back(rec);
+    }
+    fin.close();
+
+    BankHeader header;
+    memcpy(header.magic, "QBNK", 4);
+    header.version = bankversion;
+    header.count = (uint32_t)records.size();
+    header.strings = (uint32_t)(pool.offsets.size() - 1);
+    header.source_size = source_size;
+    header.source_time = source_time;
+    header.rejected = skipped;
+    header.reserved = 0;
+
+    image.clear();
+    image.reserve(sizeof(header) + records.size() * sizeof(BankRecord) + pool.offsets.size() * sizeof(uint32_t) +
+        pool.bytes.size());
+    image.append((const char*)&header, sizeof(header));
+    image.append((const char*)records.data(), records.size() * sizeof(BankRecord));
+    image.append((const char*)pool.offsets.data(), pool.offsets.size() * sizeof(uint32_t));
+    image += pool.bytes;
+    return true;
+}
+
+// ---------- Intern one string ----------
+uint32_t intern_string(StringPool& pool, string_view text) {
+    uint64_t mask = pool.slots.size() - 1;
+    for (uint64_t i = hash_key(text) & mask;; i = (i + 1) & mask) {
+        uint32_t slot = pool.slots[i];
+        if (slot == 0) break;
+        uint32_t id = slot - 1;
+        string_view existing(pool.bytes.data() + pool.offsets[id], pool.offsets[id + 1] - pool.offsets[id]);
+        if (existing == text) return id;
+    }
+
+    uint32_t id = (uint32_t)(pool.offsets.size() - 1);
+    pool.bytes.append(text.data(), text.size());
+    pool.offsets.push_back((uint32_t)pool.bytes.size());
+
+    // Rehash at half full; probes stay short while the table costs 8 bytes a string at most
+    if ((uint64_t)(id + 1) * 2 > pool.slots.size()) {
+        pool.slots.assign(pool.slots.size() * 2, 0);
+        mask = pool.slots.size() - 1;
+        for (uint32_t s = 0; s <= id; s++) {
+            string_view str(pool.bytes.data() + pool.offsets[s], pool.offsets[s + 1] - pool.offsets[s]);
+            uint64_t i = hash_key(str) & mask;
+            while (pool.slots[i] != 0) i = (i + 1) & mask;
+            pool.slots[i] = s + 1;
+        }
+        return id;
+    }
+    uint64_t i = hash_key(text) & mask;
+    while (pool.slots[i] != 0) i = (i + 1) & mask;
+    pool.slots[i] = id + 1;
+    return id;
+}
+
+// ---------- Map a compiled bank into memory ----------
+bool open_question_bank(QuestionBank& qb, string target, string source) {
+    HANDLE file = CreateFileA(target.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart < (LONGLONG)sizeof(BankHeader)) {
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping == NULL) {
+        CloseHandle(file);
+        return false;
+    }
+    const char* base = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (base == nullptr) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    qb.file = file;
+    qb.mapping = mapping;
+    qb.base = base;
+    if (!validate_question_bank(qb, (uint64_t)size.QuadPart, source)) {
+        close_question_bank(qb);
+        return false;
+    }
+    return true;
+}
+
+// ---------- Check a compiled bank and point the bank at its offset table ----------
+bool validate_question_bank(QuestionBank& qb, uint64_t total, string source) {
+    // Validate header, freshness and every record's bounds once, up front
+    const char* base = qb.base;
+    const BankHeader* header = (const BankHeader*)base;
+    uint64_t strings_start = sizeof(BankHeader) + (uint64_t)header->count * sizeof(BankRecord);
+    uint64_t text_start = strings_start + ((uint64_t)header->strings + 1) * sizeof(uint32_t);
+    bool valid = memcmp(header->magic, "QBNK", 4) == 0 && header->version == bankversion && text_start <= total;
+
+    uint64_t source_size, source_time;
+    if (valid && get_file_stamp(source, source_size, source_time)) {
+        valid = header->source_size == source_size && header->source_time == source_time;
+    }
+
+    // String offsets must rise and stay inside the file; records may only name pooled strings
+    const BankRecord* records = (const BankRecord*)(base + sizeof(BankHeader));
+    const uint32_t* string_offsets = (const uint32_t*)(base + strings_start);
+    if (valid) valid = string_offsets[0] == 0 && text_start + string_offsets[header->strings] <= total;
+    for (uint32_t i = 0; valid && i < header->strings; i++) {
+        valid = string_offsets[i] <= string_offsets[i + 1];
+    }
+    for (uint32_t i = 0; valid && i < header->count; i++) {
+        const BankRecord& rec = records[i];
+        valid = rec.correct < 4;
+        for (int f = 0; f < 5 && valid; f++) valid = rec.text[f] < header->strings;
+    }
+    if (!valid) return false;
+
+    qb.records = records;
+    qb.string_offsets = string_offsets;
+    qb.strings = base + text_start;
+    qb.count = (int)header->count;
+    qb.string_count = (int)header->strings;
+    qb.rejected = (int)header->rejected;
+    qb.size = total;
+    return true;
+}
+
+// ---------- Unmap a compiled bank ----------
+void close_question_bank(QuestionBank& qb) {
+    // A bank rebuilt on reload lives in qb.image, which the reset below frees
+    if (qb.base != nullptr && qb.mapping != NULL) UnmapViewOfFile(qb.base);
+    if (qb.mapping != NULL) CloseHandle(qb.mapping);
+    if (qb.file != INVALID_HANDLE_VALUE) CloseHandle(qb.file);
+    qb = QuestionBank();
+}
+
+// ---------- Look up one question in a mapped bank ----------
+QuestionView get_question(const QuestionBank& qb, int id) {
+    const BankRecord& rec = qb.records[id];
+
+    QuestionView view;
+    for (int i = 0; i < 5; i++) {
+        uint32_t sid = rec.text[i];
+        view.text[i] = qb.strings + qb.string_offsets[sid];
+        view.length[i] = (int)(qb.string_offsets[sid + 1] - qb.string_offsets[sid]);
+        view.text_id[i] = sid;
+    }
+    view.correct = rec.correct;
+    view.difficulty = rec.difficulty;
+    return view;
+}
+
+// ---------- Get current date and time as formatted string ----------
+string get_current_datetime() {
+    return format_datetime((int64_t)time(0));
+}
+
+// ---------- Format a Unix time as local date and time ----------
+string format_datetime(int64_t when) {
+    time_t now = (time_t)when;
+    tm t;
+
+    // Safe version of localtime
+    localtime_s(&t, &now);
+
+    // Extract date and time components
+    int year = 1900 + t.tm_year;
+    int month = 1 + t.tm_mon;
+    int day = t.tm_mday;
+    int hour = t.tm_hour;
+    int minute = t.tm_min;
+    int second = t.tm_sec;
+
+    char buffer[50];
+
+    // Format as string: YYYY-MM-DD HH:MM:SS
+    sprintf_s(buffer, "%04d-%02d-%02d %02d:%02d:%02d",
+        year, month, day, hour, minute, second);
+
+    return string(buffer);
+}
+
+// ======================= SCREEN RENDERER ============================
+
+// ---------- Enable ANSI escape processing ----------
+void screen_init() {
+    HANDLE out = GetStdHandle(STD_OUTPUT_HANDLE);
+    DWORD mode = 0;
+    screen.vt = GetConsoleMode(out, &mode) && SetConsoleMode(out, mode | ENABLE_VIRTUAL_TERMINAL_PROCESSING);
+    screen.valid = false;
+}
+
+// ---------- Lay a frame out in screen rows ----------
+void screen_layout(const string& frame, vector<string>& rows, int width) {
+    // Wrap one column early so a full row never leaves the cursor in the wrap state
+    size_t limit = width > 1 ? (size_t)(width - 1) : 1;
+    size_t used = 0;
+    rows.resize(1);
+    rows[0].clear();
+    for (char c : frame) {
+        if (c == '\n' || rows[used].size() >= limit) {
+            if (++used == rows.size()) rows.emplace_back();
+            rows[used].clear();
+            if (c == '\n') continue;
+        }
+        if (c == '\t') rows[used].append(8 - rows[used].size() % 8, ' ');
+        else if (c != '\r') rows[used] += c;
+    }
+    rows.resize(used + 1);
+}
+
+// ---------- Escapes for one changed row ----------
+void screen_diff_row(string& out, int row, const string& before, const string& after) {
+    size_t common = min(before.size(), after.size());
+    size_t first = 0;
+    while (first < common && before[first] == after[first]) first++;
+    if (first == common && before.size() == after.size()) return;
+
+    // Same length: stop at the last differing cell; shorter: erase the tail after writing
+    size_t last = after.size();
+    if (before.size() == after.size())
+        while (last > first && before[last - 1] == after[last - 1]) last--;
+
+    char move[32];
+    sprintf_s(move, "\x1b[%d;%dH", row + 1, (int)first + 1);
+    out += move;
+    out.append(after, first, last - first);
+    if (after.size() < before.size()) out += "\x1b[K";
+}
+
+// ---------- Show a frame ----------
+void screen_present(const string& frame) {
+    TraceSpan span("screen_present", "render");
+    HANDLE console = GetStdHandle(STD_OUTPUT_HANDLE);
+    if (!screen.vt) {
+        // Consoles without escape support (before Windows 10) are cleared the old way
+        TraceSpan clear("cls", "render");
+        system("cls");
+        cout << frame;
+        cout.flush();
+        return;
+    }
+
+    // One query per frame: a resize rewraps the rows, and a cursor on the
+    // bottom row means the output below the last prompt may have scrolled them
+    CONSOLE_SCREEN_BUFFER_INFO csbi;
+    if (GetConsoleScreenBufferInfo(console, &csbi)) {
+        int width = csbi.srWindow.Right - csbi.srWindow.Left + 1;
+        int height = csbi.srWindow.Bottom - csbi.srWindow.Top + 1;
+        int cursor = csbi.dwCursorPosition.Y - csbi.srWindow.Top;
+        if (width != screen.width || height != screen.height || cursor >= height - 1) screen.valid = false;
+        screen.width = width;
+        screen.height = height;
+    }
+
+    screen_layout(frame, screen.next, screen.width);
+    const vector<string>& rows = screen.next;
+    int count = (int)rows.size();
+    string& out = screen.out;
+    out.clear();
+
+    // Rows above the old prompt are exactly as drawn; diff them. Anything from the
+    // prompt down may hold typed input or later output, so it is erased and redrawn.
+    int keep = 0;
+    if (!screen.valid) out += "\x1b[H\x1b[2J";
+    else {
+        keep = min(screen.known, count);
+        for (int r = 0; r < keep; r++) screen_diff_row(out, r, screen.rows[r], rows[r]);
+        char move[32];
+        sprintf_s(move, "\x1b[%d;1H\x1b[J", keep + 1);
+        out += move;
+    }
+    for (int r = keep; r < count; r++) {
+        out += rows[r];
+        if (r + 1 < count) out += "\r\n";
+    }
+    if (keep == count) {
+        char move[32];
+        sprintf_s(move, "\x1b[%d;%dH", count, (int)rows[count - 1].size() + 1);
+        out += move;
+    }
+
+    cout.flush();  // Keep earlier stream output ahead of the frame
+    DWORD written = 0;
+    WriteFile(console, out.data(), (DWORD)out.size(), &written, NULL);
+
+    swap(screen.rows, screen.next);
+    screen.known = count - 1;
+    // A frame as tall as the window scrolls itself
+    screen.valid = count < screen.height;
+}
+
+// ---------- Patch the top row in place ----------
+void screen_status(int col, const string& text) {
+    if (screen.rows.empty() || col + (int)text.size() >= screen.width) return;
+    string& top = screen.rows[0];
+    if ((int)top.size() < col + (int)text.size()) top.resize(col + text.size(), ' ');
+
+    size_t first = 0, last = text.size();
+    while (first < last && top[col + first] == text[first]) first++;
+    while (last > first && top[col + last - 1] == text[last - 1]) last--;
+    if (first == last) return;
+
+    // Save the cursor, write the changed cells, restore it: one write per tick
+    char move[48];
+    int length = sprintf_s(move, "\x1b" "7\x1b[1;%dH", col + (int)first + 1);
+    string& out = screen.out;
+    out.assign(move, length);
+    out.append(text, first, last - first);
+    out += "\x1b" "8";
+    top.replace(col + first, last - first, text, first, last - first);
+
+    cout.flush();
+    DWORD written = 0;
+    WriteFile(GetStdHandle(STD_OUTPUT_HANDLE), out.data(), (DWORD)out.size(), &written, NULL);
+}
+
+// ======================= TIMER FUNCTIONS ============================
+
+// ---------- Update timer display at top right corner of console ----------
+void update_timer_display(int remaining) {
+    TraceSpan span("update_timer_display", "render");
+    if (screen.vt) {
+        // Usually a single changed digit
+        screen_status(60, "Time: " + to_string(remaining) + "s ");
+        return;
+    }
+
+    // Get console handle for cursor manipulation
+    HANDLE hConsole = GetStdHandle(STD_OUTPUT_HANDLE);
+    CONSOLE_SCREEN_BUFFER_INFO csbi;
+    GetConsoleScreenBufferInfo(hConsole, &csbi);
+    COORD origPos = csbi.dwCursorPosition;  // Save current cursor position
+
+    // Set cursor to top-right position
+    COORD timerPos;
+    timerPos.X = 60;
+    timerPos.Y = 0;
+    SetConsoleCursorPosition(hConsole, timerPos);
+    cout << "Time: " << remaining << "s ";
+    cout.flush();
+
+    // Restore original cursor position
+    SetConsoleCursorPosition(hConsole, origPos);
+}
+
+// ---------- Discard mouse, focus and key-up events ----------
+void drain_console_events(HANDLE input) {
+    // Otherwise they keep the input handle signalled and the wait below spins
+    INPUT_RECORD record;
+    DWORD count = 0;
+    while (PeekConsoleInputA(input, &record, 1, &count) && count == 1) {
+        if (record.EventType == KEY_EVENT && record.Event.KeyEvent.bKeyDown) break;
+        ReadConsoleInputA(input, &record, 1, &count);
+    }
+}
+
+// ---------- Get answer with countdown timer using non-blocking input ----------
+bool get_answer_with_timer(QuizSession& session, int& answer, Feedback& timeout) {
+    TraceSpan span("get_answer_with_timer", "input");
+    HANDLE input = GetStdHandle(STD_INPUT_HANDLE);
+    auto start_time = chrono::steady_clock::now();
+    timeout = Feedback();
+    long long ticked = 0;            // Whole seconds already passed to the session
+    int shown = -1;                  // Value currently on the timer display
+    bool input_received = false;
+
+    while (!input_received) {
+        // Calculate elapsed time and advance the session clock by whole seconds
+        auto current_time = chrono::steady_clock::now();
+        auto elapsed_ms = chrono::duration_cast<chrono::milliseconds>(current_time - start_time).count();
+        long long elapsed = elapsed_ms / 1000;
+        if (elapsed > ticked) {
+            timeout = session.tick((int)(elapsed - ticked));
+            ticked = elapsed;
+        }
+
+        // Update timer display once per second
+        if (session.remaining >= 0 && session.remaining != shown) {
+            update_timer_display(session.remaining);
+            shown = session.remaining;
+        }
+
+        // Check if time expired
+        if (timeout.result == RESULT_TIMEOUT) {
+            cout << "\n\nTime's up!\n";
+            cin.clear();
+            cin.ignore(10000, '\n');
+            return false;
+        }
+
+        // Check for keyboard input (non-blocking)
+        if (_kbhit()) {
+            cin >> answer;
+            cin.clear();
+            cin.ignore(10000, '\n');
+            return true;
+        }
+
+        // Sleep until the next second boundary, waking at once on a key press
+        TraceSpan wait("wait_for_key", "input");
+        drain_console_events(input);
+        WaitForSingleObject(input, (DWORD)(1000 - elapsed_ms % 1000));
+    }
+
+    return false;
+}
+
+// ======================= QUIZ SESSION ENGINE ============================
+
+// ---------- Negative marking by difficulty ----------
+int negative_mark(int level) {
+    if (level < 1 || level > 3) return 0;
+    return scoring.penalty[level];
+}
+
+// ---------- Prepare a new session ----------
+bool QuizSession::start(const QuestionBank& bank, int level, int timer, const SeenBitmap* seen,
+    uint64_t session_seed) {
+    TraceSpan span("session_start", "session");
+    // Back to a fresh session, keeping the arena's memory
+    SessionArena kept = move(arena);
+    *this = QuizSession();
+    arena = move(kept);
+    arena.reset();
+    qb = &bank;
+    difficulty = level;
+    base_timer = timer;
+    seed = session_seed != 0 ? session_seed : new_session_seed();
+    rng.seed(seed);
+    // Room for the most a session can record, so inputs never grow once questions are open:
+    // a tick per second of every clock (one more question after Replace; 50/50 and Extra Time
+    // each restart a clock of up to timer + 10 s), an answer and an adaptive pick per question
+    // and four lifelines
+    input_capacity = (sessionquestions + 3) * (max(timer, 1) + 2) + 24;
+    inputs = (SessionInput*)arena.allocate(input_capacity * sizeof(SessionInput));
+    local_metrics();  // Made here rather than by the first answer, so questions never allocate
+
+    // Adaptive: each question is picked when it is shown, from the player's rating then
+    if (level == adaptivelevel) {
+        if (bank.count <= sessionquestions) return false;
+        // Picks prefer questions the player has not seen; the history is copied, as the
+        // caller's may not last as long as the session
+        if (seen != nullptr) {
+            vector<uint64_t> seen_bits;
+            seen->fill(seen_bits, (uint32_t)bank.count);
+            seen_bank = (uint64_t*)arena.allocate(seen_bits.size() * sizeof(uint64_t));
+            copy(seen_bits.begin(), seen_bits.end(), seen_bank);
+        }
+        order_count = sessionquestions;
+        order = (int*)arena.allocate(order_count * sizeof(int));
+        fill_n(order, order_count, -1);
+        next_spare = order_count;
+        return true;
+    }
+
+    // Pick from the questions tagged with the chosen difficulty
+    const vector<int>& pool = bank.pool[level];
+    if ((int)pool.size() < sessionquestions) return false;
+    order_count = (int)pool.size();
+    order = (int*)arena.allocate(order_count * sizeof(int));
+    copy(pool.begin(), pool.end(), order);
+
+    // Unseen questions first (also for Replace); each half keeps its shuffled order
+    vector<uint64_t> seen_bits;
+    if (seen != nullptr) seen->fill(seen_bits, (uint32_t)bank.count);
+
+    shuffle_array(order, order_count, rng);
+    if (seen != nullptr) {
+        // Stable partition: unseen IDs slide forward in place, seen ones wait in the arena.
+        // A session reaches at most the first reach entries, so the trace keeps the seen IDs
+        // passed over before the reach-th unseen one, or the unseen IDs if there are fewer.
+        const int reach = sessionquestions + 1;
+        int* later = (int*)arena.allocate(order_count * sizeof(int));
+        seen_ids = (int*)arena.allocate(order_count * sizeof(int));
+        seen_count = 0;
+        int front = 0, back = 0;
+        for (int i = 0; i < order_count; i++) {
+            int id = order[i];
+            if ((seen_bits[id >> 6] >> (id & 63)) & 1) {
+                later[back++] = id;
+                if (front < reach) seen_ids[seen_count++] = id;
+            } else {
+                order[front++] = id;
+            }
+        }
+        if (front < reach) {
+            seen_inverted = true;
+            seen_count = front;
+            copy(order, order + front, seen_ids);
+        }
+        copy(later, later + back, order + front);
+    }
+    next_spare = sessionquestions;
+    return true;
+}
+
+// ---------- Open the next question ----------
+const PresentedQuestion* QuizSession::present() {
+    if (question_open) return &current;
+    if (finished || question_number >= sessionquestions) return nullptr;
+
+    if (order[question_number] < 0) choose_question(pick_question());
+    current.number = question_number;
+    current.id = order[question_number];
+    current.view = get_question(*qb, current.id);
+    current.time_limit = base_timer;
+    presented[presented_count++] = current.id;
+
+    // Shuffle options randomly
+    for (int i = 0; i < 4; i++) {
+        current.order[i] = i;
+        current.removed[i] = false;
+    }
+    for (int i = 3; i > 0; i--) {
+        int j = (int)rng.below((uint32_t)i + 1);
+        swap(current.order[i], current.order[j]);
+    }
+
+    // Find new position of correct answer after shuffle
+    for (int i = 0; i < 4; i++)
+        if (current.order[i] == current.view.correct)
+            current.correct_slot = i;
+
+    remaining = current.time_limit;
+    question_open = true;
+    if (category != 0) {
+        opened_at = chrono::steady_clock::now();
+        if (QuestionStats* stats = find_question_stats(question_stats, category, current.id)) {
+            stats->shown.fetch_add(1, memory_order_relaxed);
+        }
+    }
+    return &current;
+}
+
+// ---------- Set the next adaptive question ----------
+void QuizSession::choose_question(int id) {
+    if (difficulty != adaptivelevel || question_open || finished || question_number >= sessionquestions ||
+        id < 0 || id >= qb->count) {
+        return;
+    }
+    order[question_number] = id;
+    record_input('Q', id);
+}
+
+// ---------- Pick the next adaptive question ----------
+int QuizSession::pick_question() {
+    // Drawn from the seed, not rng, so the option shuffles stay the same when replay
+    // takes the picks from the trace instead
+    uint64_t draw = mix_hash(seed + (uint64_t)(presented_count + 1) * 0x9e3779b97f4a7c15ull);
+    int id = pick_rated_question(ratings, category, rating_player, presented, presented_count, draw, qb->count,
+        seen_bank);
+    if (id >= 0) return id;
+
+    // Without ratings: the first unshown question from a random start, unseen ones first
+    auto shown = [this](int candidate) {
+        return find(presented, presented + presented_count, candidate) != presented + presented_count;
+    };
+    int start = (int)(draw % (uint64_t)qb->count);
+    for (int step = 0; seen_bank != nullptr && step < qb->count; step++) {
+        id = (start + step) % qb->count;
+        if (!((seen_bank[id >> 6] >> (id & 63)) & 1) && !shown(id)) return id;
+    }
+    id = start;
+    while (shown(id)) id = (id + 1) % qb->count;
+    return id;
+}
+
+// ---------- Answer the open question ----------
+Feedback QuizSession::answer(int slot) {
+    Feedback fb;
+    if (!question_open) {
+        fb.accepted = false;
+        return fb;
+    }
+    record_input('A', slot);
+
+    // Wrong answer (including removed options and out-of-range input)
+    if (slot != current.correct_slot) return penalize(RESULT_WRONG);
+
+    fb.result = RESULT_CORRECT;
+    fb.correct_slot = current.correct_slot;
+    fb.points = 1;
+    streak++;
+    correct_count++;
+
+    // Apply streak bonuses
+    if (streak == scoring.short_streak) {
+        fb.bonus = scoring.short_bonus;
+    }
+    else if (streak == scoring.long_streak) {
+        fb.bonus = scoring.long_bonus;
+        if (scoring.reset_after_long) streak = 0;  // Reset after the long streak
+    }
+    fb.points += fb.bonus;
+    score += fb.points;
+
+    close_question(RESULT_CORRECT);
+    return fb;
+}
+
+// ---------- Use a lifeline on the open question ----------
+Feedback QuizSession::use_lifeline(int lifeline) {
+    Feedback fb;
+    fb.correct_slot = current.correct_slot;
+    if (!question_open) {
+        fb.accepted = false;
+        return fb;
+    }
+    bool available = (lifeline == LIFELINE_5050 && lifeline_5050) || (lifeline == LIFELINE_SKIP && lifeline_skip) ||
+        (lifeline == LIFELINE_REPLACE && lifeline_replace) || (lifeline == LIFELINE_EXTRATIME && lifeline_extratime);
+    if (available) record_input('L', lifeline);  // A used-up lifeline changes nothing
+    if (category != 0 && available) {
+        record_lifeline_metric(category, lifeline);
+        QuestionStats* stats = find_question_stats(question_stats, category, current.id);
+        if (stats != nullptr && lifeline == LIFELINE_5050) stats->fifty_fifty.fetch_add(1, memory_order_relaxed);
+    }
+
+    switch (lifeline) {
+    case LIFELINE_5050: {
+        if (!lifeline_5050) break;
+        lifeline_5050 = false;
+
+        // Remove 2 incorrect options; the clock restarts for the reduced question
+        int removed = 0;
+        for (int i = 0; i < 4 && removed < 2; ++i) {
+            if (i != current.correct_slot) {
+                current.removed[i] = true;
+                removed++;
+            }
+        }
+        remaining = current.time_limit;
+        return fb;
+    }
+    case LIFELINE_SKIP:
+        if (!lifeline_skip) break;
+        lifeline_skip = false;
+        fb.result = RESULT_SKIPPED;
+        close_question(RESULT_SKIPPED);
+        return fb;
+
+    case LIFELINE_REPLACE:
+        if (!lifeline_replace) break;
+        lifeline_replace = false;
+
+        // Everything past the session's questions in the shuffled pool is unused;
+        // an adaptive session picks again
+        if (difficulty == adaptivelevel) {
+            order[question_number] = -1;
+        }
+        else if (next_spare < order_count) {
+            order[question_number] = order[next_spare++];
+        }
+        fb.result = RESULT_REPLACED;
+        close_question(RESULT_REPLACED);
+        return fb;
+
+    case LIFELINE_EXTRATIME:
+        if (!lifeline_extratime) break;
+        lifeline_extratime = false;
+        current.time_limit += 10;  // Add 10 seconds
+        remaining = current.time_limit;
+        return fb;
+    }
+
+    fb.accepted = false;  // Already used or not a lifeline
+    return fb;
+}
+
+// ---------- Advance the question clock ----------
+Feedback QuizSession::tick(int seconds) {
+    Feedback fb;
+    if (!question_open) return fb;
+    if (seconds > 0) record_input('T', seconds);
+
+    remaining -= seconds;
+    if (remaining > 0) {
+        fb.correct_slot = current.correct_slot;
+        return fb;
+    }
+    remaining = 0;
+    return penalize(RESULT_TIMEOUT);
+}
+
+// ---------- End the session ----------
+SessionSummary QuizSession::finish() {
+    if (question_open) close_question(RESULT_NONE);
+    if (category != 0 && !finished) record_session_metric(category);
+    finished = true;
+
+    SessionSummary summary;
+    summary.score = score;
+    summary.correct = correct_count;
+    summary.wrong = wrong_count;
+    summary.outcomes = outcomes;
+    return summary;
+}
+
+// ---------- Option text for a displayed slot ----------
+string_view QuizSession::option_text(int slot) const {
+    if (current.removed[slot]) return "[REMOVED]";
+    int option = current.order[slot] + 1;
+    return string_view(current.view.text[option], current.view.length[option]);
+}
+
+// ---------- Apply negative marking to the open question ----------
+Feedback QuizSession::penalize(AnswerResult result) {
+    Feedback fb;
+    fb.result = result;
+    fb.correct_slot = current.correct_slot;
+    fb.points = -negative_mark(difficulty == adaptivelevel ? current.view.difficulty : difficulty);
+    score += fb.points;
+    streak = 0;
+    wrong_count++;
+
+    // Store for review: the question's ID and how it was displayed
+    ReviewItem& item = incorrect[incorrect_count++];
+    item.id = current.id;
+    item.permutation = pack_permutation(current.order);
+    item.removed = 0;
+    for (int i = 0; i < 4; i++)
+        if (current.removed[i]) item.removed |= 1 << i;
+    item.correct_pos = (uint8_t)current.correct_slot;
+
+    close_question(result);
+    return fb;
+}
+
+// ---------- Close the open question ----------
+void QuizSession::close_question(AnswerResult result) {
+    question_open = false;
+    if (category != 0 && result != RESULT_NONE) {
+        uint64_t latency_us = 0;
+        if (result == RESULT_CORRECT || result == RESULT_WRONG) {
+            latency_us = (uint64_t)chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - opened_at).count();
+        }
+        record_question_metrics(category, result, latency_us);
+        record_question_stats(question_stats, category, current.id, result, latency_us);
+    }
+    if (result == RESULT_NONE || result == RESULT_REPLACED) return;
+    if (rating_player != 0 && result != RESULT_SKIPPED) {
+        rate_answer(ratings, category, current.id, rating_player, result == RESULT_CORRECT);
+    }
+
+    outcomes |= (uint32_t)result << (question_number * outcomebits);
+    question_number++;
+}
+
+// ---------- Record an input for replay ----------
+void QuizSession::record_input(char kind, int value) {
+    // start() sizes the array for the worst case; past that it doubles within the arena
+    if (input_count == input_capacity) {
+        SessionInput* grown = (SessionInput*)arena.allocate(input_capacity * 2 * sizeof(SessionInput));
+        copy(inputs, inputs + input_count, grown);
+        inputs = grown;
+        input_capacity *= 2;
+    }
+    inputs[input_count].kind = kind;
+    inputs[input_count].value = value;
+    input_count++;
+}
+
+// ---------- Option order as a byte ----------
+uint8_t pack_permutation(const int order[4]) {
+    uint8_t permutation = 0;
+    for (int i = 0; i < 4; i++) permutation |= (uint8_t)(order[i] << (i * 2));
+    return permutation;
+}
+
+// ---------- Option order from a byte ----------
+void unpack_permutation(uint8_t permutation, int order[4]) {
+    for (int i = 0; i < 4; i++) order[i] = (permutation >> (i * 2)) & 3;
+}
+
+// ---------- Arena allocation ----------
+void* SessionArena::allocate(size_t bytes) {
+    bytes = (bytes + 15) & ~(size_t)15;
+    if (blocks.empty() || used + bytes > sizes.back()) {
+        size_t size = max(arenablock, bytes);
+        if (!sizes.empty()) size = max(size, sizes.back() * 2);
+        blocks.push_back(unique_ptr<char[]>(new char[size]));
+        sizes.push_back(size);
+        used = 0;
+    }
+    void* p = blocks.back().get() + used;
+    used += bytes;
+    return p;
+}
+
+// ---------- Release an arena's allocations ----------
+void SessionArena::reset() {
+    // A session that outgrew the first block gets one block big enough for all of it next time
+    if (blocks.size() > 1) {
+        size_t total = 0;
+        for (size_t size : sizes) total += size;
+        blocks.clear();
+        sizes.clear();
+        blocks.push_back(unique_ptr<char[]>(new char[total]));
+        sizes.push_back(total);
+    }
+    used = 0;
+}
+
+// ======================= SEEN-QUESTION HISTORY ============================
+
+// ---------- Is an ID in the set ----------
+bool SeenBitmap::contains(uint32_t id) const {
+    uint16_t high = (uint16_t)(id >> 16), low = (uint16_t)id;
+    for (const SeenContainer& c : containers) {
+        if (c.high != high) continue;
+        if (!c.bits.empty()) return (c.bits[low >> 6] >> (low & 63)) & 1;
+        return binary_search(c.values.begin(), c.values.end(), low);
+    }
+    return false;
+}
+
+// ---------- Add an ID ----------
+void SeenBitmap::add(uint32_t id) {
+    uint16_t high = (uint16_t)(id >> 16), low = (uint16_t)id;
+    auto c = lower_bound(containers.begin(), containers.end(), high,
+        [](const SeenContainer& a, uint16_t h) { return a.high < h; });
+    if (c == containers.end() || c->high != high) {
+        c = containers.insert(c, SeenContainer());
+        c->high = high;
+    }
+
+    if (!c->bits.empty()) {
+        c->bits[low >> 6] |= 1ull << (low & 63);
+        return;
+    }
+    auto at = lower_bound(c->values.begin(), c->values.end(), low);
+    if (at != c->values.end() && *at == low) return;
+    c->values.insert(at, low);
+
+    // Past seenarraymax IDs a bitmap (8 KB) is smaller than the array
+    if ((int)c->values.size() > seenarraymax) {
+        c->bits.assign(1024, 0);
+        for (uint16_t v : c->values) c->bits[v >> 6] |= 1ull << (v & 63);
+        c->values.clear();
+        c->values.shrink_to_fit();
+    }
+}
+
+// ---------- Expand into a flat bitset for O(1) tests ----------
+void SeenBitmap::fill(vector<uint64_t>& dense, uint32_t limit) const {
+    dense.assign((limit + 63) / 64, 0);
+    for (const SeenContainer& c : containers) {
+        uint32_t base = (uint32_t)c.high << 16;
+        if (base >= limit) break;
+        if (!c.bits.empty()) {
+            // Containers start on a word boundary, so bitmap words copy straight across
+            size_t first = base >> 6;
+            for (size_t w = 0; w < 1024 && first + w < dense.size(); w++) dense[first + w] |= c.bits[w];
+        } else {
+            for (uint16_t v : c.values) {
+                uint32_t id = base + v;
+                if (id < limit) dense[id >> 6] |= 1ull << (id & 63);
+            }
+        }
+    }
+
+    // Drop IDs at or past limit that came in with the last word
+    if (limit % 64 != 0 && !dense.empty()) dense.back() &= (1ull << (limit % 64)) - 1;
+}
+
+// ---------- Serialize: count, then (high, kind, cardinality, payload) per container ----------
+void SeenBitmap::serialize(string& out) const {
+    out.clear();
+    uint32_t count = (uint32_t)containers.size();
+    out.append((const char*)&count, sizeof(count));
+    for (const SeenContainer& c : containers) {
+        uint16_t kind = c.bits.empty() ? 0 : 1;
+        uint32_t cardinality = (uint32_t)c.values.size();
+        if (kind == 1) {
+            cardinality = 0;
+            for (uint64_t word : c.bits) cardinality += (uint32_t)bitset<64>(word).count();
+        }
+        out.append((const char*)&c.high, sizeof(c.high));
+        out.append((const char*)&kind, sizeof(kind));
+        out.append((const char*)&cardinality, sizeof(cardinality));
+        if (kind == 1) out.append((const char*)c.bits.data(), 1024 * sizeof(uint64_t));
+        else out.append((const char*)c.values.data(), c.values.size() * sizeof(uint16_t));
+    }
+}
+
+// ---------- Deserialize, rejecting anything malformed ----------
+bool SeenBitmap::deserialize(string_view data) {
+    containers.clear();
+    uint32_t count;
+    if (data.size() < sizeof(count)) return false;
+    memcpy(&count, data.data(), sizeof(count));
+    size_t pos = sizeof(count);
+
+    for (uint32_t i = 0; i < count; i++) {
+        SeenContainer c;
+        uint16_t kind;
+        uint32_t cardinality;
+        if (data.size() - pos < 8) return false;
+        memcpy(&c.high, data.data() + pos, 2);
+        memcpy(&kind, data.data() + pos + 2, 2);
+        memcpy(&cardinality, data.data() + pos + 4, 4);
+        pos += 8;
+        if (!containers.empty() && c.high <= containers.back().high) return false;
+
+        if (kind == 1) {
+            if (data.size() - pos < 1024 * sizeof(uint64_t)) return false;
+            c.bits.resize(1024);
+            memcpy(c.bits.data(), data.data() + pos, 1024 * sizeof(uint64_t));
+            pos += 1024 * sizeof(uint64_t);
+        } else {
+            if (kind != 0 || cardinality > 65536 || data.size() - pos < cardinality * sizeof(uint16_t)) return false;
+            c.values.resize(cardinality);
+            memcpy(c.values.data(), data.data() + pos, cardinality * sizeof(uint16_t));
+            pos += cardinality * sizeof(uint16_t);
+        }
+        containers.push_back(move(c));
+    }
+    return true;
+}
+
+// ---------- History key and hash ----------
+string seen_key(string_view player, int cat) {
+    return to_string(cat) + ":" + string(player);
+}
+
+uint64_t hash_key(string_view key) {
+    uint64_t hash = 14695981039346656037ull;
+    for (unsigned char c : key) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// ---------- Open or create the history store ----------
+bool seen_store_open(SeenStore& store, string name) {
+    string index_name = name + ".idx", data_name = name + ".dat";
+
+    // fstream in/out mode needs the files to exist
+    { ofstream create(index_name, ios::binary | ios::app); }
+    { ofstream create(data_name, ios::binary | ios::app); }
+    store.index.open(index_name, ios::in | ios::out | ios::binary);
+    store.data.open(data_name, ios::in | ios::out | ios::binary);
+    if (!store.index.is_open() || !store.data.is_open()) {
+        cout << "Error opening " << name << "\n";
+        return false;
+    }
+
+    store.index.seekg(0, ios::end);
+    uint64_t size = (uint64_t)store.index.tellg();
+    if (size == 0) {
+        // New store: header and an empty slot table
+        memcpy(store.header.magic, "QSIX", 4);
+        store.header.version = seenversion;
+        store.header.capacity = seeninitialslots;
+        store.header.used = 0;
+        vector<SeenSlot> slots(seeninitialslots, SeenSlot{ 0, 0 });
+        store.index.seekp(0);
+        store.index.write((const char*)&store.header, sizeof(store.header));
+        store.index.write((const char*)slots.data(), slots.size() * sizeof(SeenSlot));
+        store.index.flush();
+    } else {
+        store.index.seekg(0);
+        store.index.read((char*)&store.header, sizeof(store.header));
+        uint64_t capacity = store.header.capacity;
+        if (!store.index || memcmp(store.header.magic, "QSIX", 4) != 0 || store.header.version != seenversion ||
+            capacity == 0 || (capacity & (capacity - 1)) != 0 ||
+            size != sizeof(SeenIndexHeader) + capacity * sizeof(SeenSlot)) {
+            cout << "Ignoring damaged " << index_name << "\n";
+            store.index.close();
+            store.data.close();
+            return false;
+        }
+    }
+
+    store.open = true;
+    return true;
+}
+
+// ---------- Probe the index for a key ----------
+uint64_t seen_store_find(SeenStore& store, string_view key, uint64_t hash, uint64_t& record) {
+    uint64_t mask = store.header.capacity - 1;
+    string stored;
+    for (uint64_t i = hash & mask;; i = (i + 1) & mask) {
+        SeenSlot slot;
+        store.index.seekg(sizeof(SeenIndexHeader) + i * sizeof(SeenSlot));
+        store.index.read((char*)&slot, sizeof(slot));
+        if (!store.index || slot.offset == 0) {
+            store.index.clear();
+            record = 0;
+            return i;
+        }
+        if (slot.hash != hash) continue;
+
+        // Same hash: compare the stored key to rule out a collision
+        SeenRecordHeader header;
+        store.data.seekg(slot.offset - 1);
+        store.data.read((char*)&header, sizeof(header));
+        stored.resize(header.key_length);
+        store.data.read(&stored[0], header.key_length);
+        if (store.data && stored == key) {
+            record = slot.offset;
+            return i;
+        }
+        store.data.clear();
+    }
+}
+
+// ---------- Read one key's seen set ----------
+bool seen_store_load(SeenStore& store, string_view key, SeenBitmap& bitmap) {
+    bitmap = SeenBitmap();
+    lock_guard<mutex> lock(store.lock);
+    if (!store.open) return false;
+
+    uint64_t record;
+    seen_store_find(store, key, hash_key(key), record);
+    if (record == 0) return false;
+
+    SeenRecordHeader header;
+    store.data.seekg(record - 1);
+    store.data.read((char*)&header, sizeof(header));
+    store.data.seekg(header.key_length, ios::cur);
+    string bytes(header.bitmap_bytes, '\0');
+    store.data.read(&bytes[0], header.bitmap_bytes);
+    if (!store.data || !bitmap.deserialize(bytes)) {
+        store.data.clear();
+        bitmap = SeenBitmap();
+        return false;
+    }
+    return true;
+}
+
+// ---------- Mark IDs seen under a key ----------
+void seen_store_add(SeenStore& store, string_view key, const vector<int>& ids) {
+    lock_guard<mutex> lock(store.lock);
+    if (!store.open) return;
+
+    uint64_t hash = hash_key(key), record;
+    uint64_t slot = seen_store_find(store, key, hash, record);
+
+    SeenRecordHeader header;
+    SeenBitmap bitmap;
+    string bytes;
+    if (record != 0) {
+        store.data.seekg(record - 1);
+        store.data.read((char*)&header, sizeof(header));
+        store.data.seekg(header.key_length, ios::cur);
+        bytes.resize(header.bitmap_bytes);
+        store.data.read(&bytes[0], header.bitmap_bytes);
+        if (!store.data || !bitmap.deserialize(bytes)) {
+            store.data.clear();
+            bitmap = SeenBitmap();
+        }
+    }
+    for (int id : ids) bitmap.add((uint32_t)id);
+    bitmap.serialize(bytes);
+
+    if (record != 0 && bytes.size() <= header.capacity) {
+        // Still fits: rewrite the record in place
+        header.bitmap_bytes = (uint32_t)bytes.size();
+        store.data.seekp(record - 1);
+        store.data.write((const char*)&header, sizeof(header));
+        store.data.seekp(header.key_length, ios::cur);
+        store.data.write(bytes.data(), bytes.size());
+        return;
+    }
+
+    // New or outgrown: append with room to grow, then point the slot at it
+    uint32_t capacity = 64;
+    while (capacity < bytes.size() * 2) capacity *= 2;
+    header.hash = hash;
+    header.key_length = (uint16_t)key.size();
+    header.reserved = 0;
+    header.capacity = capacity;
+    header.bitmap_bytes = (uint32_t)bytes.size();
+    header.reserved2 = 0;
+    bytes.resize(capacity, '\0');
+
+    store.data.seekp(0, ios::end);
+    uint64_t offset = (uint64_t)store.data.tellp();
+    store.data.write((const char*)&header, sizeof(header));
+    store.data.write(key.data(), header.key_length);
+    store.data.write(bytes.data(), bytes.size());
+
+    SeenSlot entry = { hash, offset + 1 };
+    store.index.seekp(sizeof(SeenIndexHeader) + slot * sizeof(SeenSlot));
+    store.index.write((const char*)&entry, sizeof(entry));
+    if (record == 0) {
+        store.header.used++;
+        store.index.seekp(0);
+        store.index.write((const char*)&store.header, sizeof(store.header));
+        if (store.header.used * 10 > store.header.capacity * 7) seen_store_grow(store);
+    }
+}
+
+// ---------- Double the index ----------
+void seen_store_grow(SeenStore& store) {
+    // Only the slots move; records stay where they are in the data file
+    vector<SeenSlot> old(store.header.capacity);
+    store.index.seekg(sizeof(SeenIndexHeader));
+    store.index.read((char*)old.data(), old.size() * sizeof(SeenSlot));
+
+    uint64_t capacity = store.header.capacity * 2, mask = capacity - 1;
+    vector<SeenSlot> slots(capacity, SeenSlot{ 0, 0 });
+    for (const SeenSlot& slot : old) {
+        if (slot.offset == 0) continue;
+        uint64_t i = slot.hash & mask;
+        while (slots[i].offset != 0) i = (i + 1) & mask;
+        slots[i] = slot;
+    }
+
+    store.header.capacity = capacity;
+    store.index.seekp(0);
+    store.index.write((const char*)&store.header, sizeof(store.header));
+    store.index.write((const char*)slots.data(), slots.size() * sizeof(SeenSlot));
+    store.index.flush();
+}
+
+// ---------- Player history for a category ----------
+void load_seen_questions(string_view player, int cat, SeenBitmap& seen) {
+    TraceSpan span("load_seen_questions", "history");
+    seen_store_load(history, seen_key(player, cat), seen);
+}
+
+// ---------- Queue a session's questions for the history ----------
+void record_seen_questions(string_view player, int cat, const int* ids, int count) {
+    TraceSpan span("record_seen_questions", "history");
+    WriteRecord* rec = new WriteRecord;
+    rec->file = WRITER_HISTORY;
+    rec->text = seen_key(player, cat);
+    rec->ids.assign(ids, ids + count);
+    writer_push(rec);
+}
+
+// ======================= ADAPTIVE DIFFICULTY ============================
+
+// ---------- Open the rating table ----------
+bool rating_store_open(RatingStore& store, string path, const QuestionBank* const banks[6]) {
+    TraceSpan span("rating_store_open", "io");
+    scoped_lock lock(store.lock[1], store.lock[2], store.lock[3], store.lock[4], store.lock[5]);
+    store.path = path;
+    uint64_t size, time;
+    bool mapped = rating_store_map(store);
+    if (!mapped && get_file_stamp(path, size, time)) cout << "Rebuilding damaged " << path << "\n";
+
+    // Rewritten only when it is new or a bank has outgrown it; otherwise used in place
+    uint32_t questions[6] = {};
+    bool fits = mapped;
+    for (int cat = 1; cat <= 5; cat++) {
+        if (mapped) questions[cat] = store.header->questions[cat];
+        if (banks[cat] != nullptr && (uint32_t)banks[cat]->count > questions[cat]) {
+            questions[cat] = (uint32_t)banks[cat]->count;
+            fits = false;
+        }
+    }
+    // The player table starts with room to grow, so session starts rarely have to double it
+    uint32_t player_slots = mapped ? store.header->player_slots : ratingplayerslots;
+    while (mapped && (uint64_t)store.header->players * ratingheadroom > player_slots) {
+        player_slots *= 2;
+        fits = false;
+    }
+    if (!fits && !rating_store_rewrite(store, questions, player_slots, banks)) return false;
+
+    // The index is rebuilt from the stored ratings, not from the answers that made them
+    for (int cat = 1; cat <= 5; cat++) {
+        store.index[cat].clear();
+        for (uint32_t id = 0; id < store.header->questions[cat]; id++) {
+            store.index[cat].insert(rating_order(store.questions[cat][id].value) << 32 | id);
+        }
+    }
+    return true;
+}
+
+// ---------- Flush and close the rating table ----------
+void rating_store_close(RatingStore& store) {
+    scoped_lock lock(store.lock[1], store.lock[2], store.lock[3], store.lock[4], store.lock[5]);
+    if (store.base != nullptr) FlushViewOfFile(store.base, 0);
+    rating_store_unmap(store);
+    for (auto& index : store.index) index.clear();
+}
+
+// ---------- Map the rating table read-write ----------
+bool rating_store_map(RatingStore& store) {
+    store.base = map_whole_file(store.path, true, store.file, store.mapping, store.size);
+    if (store.base == nullptr || store.size < sizeof(RatingHeader)) {
+        rating_store_unmap(store);
+        return false;
+    }
+
+    // The sections must add up to exactly the file
+    const RatingHeader* header = (const RatingHeader*)store.base;
+    uint64_t expected = sizeof(RatingHeader) + (uint64_t)header->player_slots * sizeof(PlayerRating);
+    for (int cat = 1; cat <= 5; cat++) expected += (uint64_t)header->questions[cat] * sizeof(Rating);
+    if (memcmp(header->magic, "QRTG", 4) != 0 || header->version != ratingversion || header->player_slots == 0 ||
+        (header->player_slots & (header->player_slots - 1)) != 0 || expected != store.size) {
+        rating_store_unmap(store);
+        return false;
+    }
+
+    store.header = (RatingHeader*)store.base;
+    char* section = store.base + sizeof(RatingHeader);
+    for (int cat = 1; cat <= 5; cat++) {
+        store.questions[cat] = (Rating*)section;
+        section += store.header->questions[cat] * sizeof(Rating);
+    }
+    store.players = (PlayerRating*)section;
+    return true;
+}
+
+// ---------- Unmap the rating table ----------
+void rating_store_unmap(RatingStore& store) {
+    if (store.base != nullptr) UnmapViewOfFile(store.base);
+    if (store.mapping != NULL) CloseHandle(store.mapping);
+    if (store.file != INVALID_HANDLE_VALUE) CloseHandle(store.file);
+    store.file = INVALID_HANDLE_VALUE;
+    store.mapping = NULL;
+    store.base = nullptr;
+    store.size = 0;
+    store.header = nullptr;
+    fill_n(store.questions, 6, nullptr);
+    store.players = nullptr;
+}
+
+// ---------- Rewrite the rating table with a new layout ----------
+bool rating_store_rewrite(RatingStore& store, const uint32_t questions[6], uint32_t player_slots,
+    const QuestionBank* const banks[6]) {
+    TraceSpan span("rating_store_rewrite", "io");
+    uint64_t size = sizeof(RatingHeader) + (uint64_t)player_slots * sizeof(PlayerRating);
+    for (int cat = 1; cat <= 5; cat++) size += (uint64_t)questions[cat] * sizeof(Rating);
+    vector<char> image((size_t)size, 0);
+    RatingHeader* header = (RatingHeader*)image.data();
+    memcpy(header->magic, "QRTG", 4);
+    header->version = ratingversion;
+    header->player_slots = player_slots;
+
+    // Question ratings keep their IDs; new questions start from their difficulty tag
+    Rating* ratings_out = (Rating*)(image.data() + sizeof(RatingHeader));
+    for (int cat = 1; cat <= 5; cat++) {
+        header->questions[cat] = questions[cat];
+        uint32_t kept = store.base != nullptr ? min(questions[cat], store.header->questions[cat]) : 0;
+        copy(store.questions[cat], store.questions[cat] + kept, ratings_out);
+        for (uint32_t id = kept; id < questions[cat]; id++) {
+            int tag = banks != nullptr && banks[cat] != nullptr && id < (uint32_t)banks[cat]->count ?
+                get_question(*banks[cat], (int)id).difficulty : 0;
+            ratings_out[id] = Rating{ ratingprior[tag >= 1 && tag <= 3 ? tag : 0], 0 };
+        }
+        ratings_out += questions[cat];
+    }
+
+    // Players are rehashed into the new table
+    PlayerRating* players = (PlayerRating*)ratings_out;
+    uint32_t mask = player_slots - 1;
+    for (uint32_t i = 0; store.base != nullptr && i < store.header->player_slots; i++) {
+        const PlayerRating& player = store.players[i];
+        if (player.key == 0) continue;
+        uint32_t slot = (uint32_t)player.key & mask;
+        while (players[slot].key != 0) slot = (slot + 1) & mask;
+        players[slot] = player;
+        header->players++;
+    }
+
+    rating_store_unmap(store);
+    if (!replace_file(store.path, image) || !rating_store_map(store)) {
+        cout << "Cannot write " << store.path << "\n";
+        return false;
+    }
+    return true;
+}
+
+// ---------- Find or add a player's rating ----------
+PlayerRating* find_player_rating(RatingStore& store, uint64_t key, bool add) {
+    if (add && ((uint64_t)store.header->players + 1) * 2 > store.header->player_slots) {
+        uint32_t questions[6];
+        copy(store.header->questions, store.header->questions + 6, questions);
+        if (!rating_store_rewrite(store, questions, store.header->player_slots * 2, nullptr)) return nullptr;
+    }
+
+    uint32_t mask = store.header->player_slots - 1;
+    for (uint32_t i = (uint32_t)key & mask;; i = (i + 1) & mask) {
+        PlayerRating& slot = store.players[i];
+        if (slot.key == key) return &slot;
+        if (slot.key != 0) continue;
+        if (!add) return nullptr;
+        slot.key = key;
+        slot.rating = Rating{ ratingstart, 0 };
+        store.header->players++;
+        return &slot;
+    }
+}
+
+// ---------- Rating key of a player ----------
+uint64_t rating_player_key(string_view player, int cat) {
+    uint64_t key = hash_key(seen_key(player, cat));
+    return key != 0 ? key : 1;
+}
+
+// ---------- Player's current rating ----------
+float player_rating(RatingStore& store, int cat, uint64_t player) {
+    if (cat < 1 || cat > 5) return ratingstart;
+    lock_guard<mutex> lock(store.lock[cat]);
+    if (store.base == nullptr) return ratingstart;
+    const PlayerRating* slot = find_player_rating(store, player, false);
+    return slot != nullptr ? slot->rating.value : ratingstart;
+}
+
+// ---------- Index order of a rating ----------
+uint64_t rating_order(float rating) {
+    return (uint64_t)(max(rating, 0.0f) * 16);
+}
+
+// ---------- Elo update ----------
+void update_rating(Rating& rating, float opponent, float outcome, float k_min, float k_max) {
+    float expected = 1 / (1 + pow(10.0f, (opponent - rating.value) / 400));
+    float k = k_min + (k_max - k_min) * ratingsettle / (ratingsettle + rating.answers);
+    rating.value = clamp(rating.value + k * (outcome - expected), ratingmin, ratingmax);
+    rating.answers++;
+}
+
+// ---------- Rate an answer ----------
+void rate_answer(RatingStore& store, int cat, int id, uint64_t player, bool correct) {
+    if (cat < 1 || cat > 5 || id < 0) return;
+    lock_guard<mutex> lock(store.lock[cat]);
+    if (store.base == nullptr) return;
+    PlayerRating* slot = find_player_rating(store, player, false);  // Registered at session start
+    if (slot == nullptr || (uint32_t)id >= store.header->questions[cat]) return;
+
+    // The player wins by answering correctly, the question by being missed
+    Rating& question = store.questions[cat][id];
+    float player_before = slot->rating.value, question_before = question.value;
+    update_rating(slot->rating, question_before, correct ? 1.0f : 0.0f, playerkmin, playerkmax);
+    update_rating(question, player_before, correct ? 0.0f : 1.0f, questionkmin, questionkmax);
+
+    // Re-key the question's index node in place (no allocation)
+    uint64_t old_key = rating_order(question_before) << 32 | (uint32_t)id;
+    uint64_t new_key = rating_order(question.value) << 32 | (uint32_t)id;
+    if (old_key == new_key) return;
+    auto node = store.index[cat].extract(old_key);
+    if (node.empty()) return;
+    node.value() = new_key;
+    store.index[cat].insert(move(node));
+}
+
+// ---------- Pick a question near the player's rating ----------
+int pick_rated_question(RatingStore& store, int cat, uint64_t player, const int* exclude, int excluded,
+    uint64_t draw, int count, const uint64_t* seen) {
+    if (cat < 1 || cat > 5) return -1;
+    lock_guard<mutex> lock(store.lock[cat]);
+    if (store.base == nullptr || store.index[cat].empty()) return -1;
+    const PlayerRating* slot = find_player_rating(store, player, false);
+    uint64_t target = rating_order((slot != nullptr ? slot->rating.value : ratingstart) - ratingtarget);
+
+    // Walk outward from the target, nearer side first, until the window is full
+    const set<uint64_t>& index = store.index[cat];
+    auto up = index.lower_bound(target << 32), down = up;
+    // Unseen questions gather at the front of the window and are drawn from first
+    int window[adaptivewindow], found = 0, unseen = 0;
+    while (found < adaptivewindow && (up != index.end() || down != index.begin())) {
+        uint64_t key;
+        if (up != index.end() && (down == index.begin() || (*up >> 32) - target <= target - (*prev(down) >> 32))) {
+            key = *up++;
+        }
+        else key = *--down;
+        int id = (int)(uint32_t)key;
+        if (id >= count || find(exclude, exclude + excluded, id) != exclude + excluded) continue;
+        window[found] = id;
+        if (seen == nullptr || !((seen[id >> 6] >> (id & 63)) & 1)) swap(window[found], window[unseen++]);
+        found++;
+    }
+    if (found == 0) return -1;
+    return unseen > 0 ? window[draw % unseen] : window[draw % found];
+}
+
+// ---------- Register a player before a session ----------
+bool register_rating_player(RatingStore& store, int cat, uint64_t key) {
+    if (cat < 1 || cat > 5) return false;
+    {
+        lock_guard<mutex> lock(store.lock[cat]);
+        if (store.base == nullptr) return false;
+        if (find_player_rating(store, key, false) != nullptr) return true;
+    }
+
+    // A new player: every category's answers stop while the slot is claimed (and the table grows)
+    scoped_lock lock(store.lock[1], store.lock[2], store.lock[3], store.lock[4], store.lock[5]);
+    return store.base != nullptr && find_player_rating(store, key, true) != nullptr;
+}
+
+// ---------- Rate the questions a reload added ----------
+bool rating_store_extend(RatingStore& store, int cat, const QuestionBank& bank) {
+    if (cat < 1 || cat > 5) return false;
+    scoped_lock lock(store.lock[1], store.lock[2], store.lock[3], store.lock[4], store.lock[5]);
+    if (store.base == nullptr) return false;
+    uint32_t had = store.header->questions[cat];
+    if ((uint32_t)bank.count <= had) return true;
+
+    // New questions start from their tag's prior; with every lock held no answer is in the old mapping
+    uint32_t questions[6];
+    copy(store.header->questions, store.header->questions + 6, questions);
+    questions[cat] = (uint32_t)bank.count;
+    const QuestionBank* banks[6] = {};
+    banks[cat] = &bank;
+    if (!rating_store_rewrite(store, questions, store.header->player_slots, banks)) return false;
+    for (uint32_t id = had; id < questions[cat]; id++) {
+        store.index[cat].insert(rating_order(store.questions[cat][id].value) << 32 | id);
+    }
+    return true;
+}
+
+// ======================= QUESTION STATISTICS ============================
+
+// ---------- Open the statistics table ----------
+bool stats_store_open(StatsStore& store, const QuestionBank* const banks[6]) {
+    TraceSpan span("stats_store_open", "io");
+    uint64_t size, time;
+    bool mapped = stats_store_map(store);
+    if (!mapped && get_file_stamp(store.path, size, time)) cout << "Rebuilding damaged " << store.path << "\n";
+
+    uint32_t questions[6] = {};
+    bool fits = mapped;
+    for (int cat = 1; cat <= 5; cat++) {
+        if (mapped) questions[cat] = store.header->questions[cat];
+        if (banks[cat] != nullptr && (uint32_t)banks[cat]->count > questions[cat]) {
+            questions[cat] = (uint32_t)banks[cat]->count;
+            fits = false;
+        }
+    }
+    if (!fits) {
+        // Counters keep their IDs; new questions start from zero
+        uint64_t total = sizeof(StatsHeader);
+        for (int cat = 1; cat <= 5; cat++) total += (uint64_t)questions[cat] * sizeof(QuestionStats);
+        vector<char> image((size_t)total, 0);
+        StatsHeader* header = (StatsHeader*)image.data();
+        memcpy(header->magic, "QSTS", 4);
+        header->version = statsversion;
+        char* section = image.data() + sizeof(StatsHeader);
+        for (int cat = 1; cat <= 5; cat++) {
+            header->questions[cat] = questions[cat];
+            if (mapped) memcpy(section, (const char*)store.questions[cat], store.header->questions[cat] * sizeof(QuestionStats));
+            section += questions[cat] * sizeof(QuestionStats);
+        }
+        stats_store_unmap(store);
+        if (!replace_file(store.path, image) || !stats_store_map(store)) {
+            cout << "Cannot write " << store.path << "\n";
+            return false;
+        }
+    }
+
+    if (store.interval_ms < 100) store.interval_ms = 100;
+    store.stopping = false;
+    store.worker = thread(stats_sync_loop, ref(store));
+    return true;
+}
+
+// ---------- Map the statistics table ----------
+bool stats_store_map(StatsStore& store, bool writable) {
+    store.base = map_whole_file(store.path, writable, store.file, store.mapping, store.size);
+    if (store.base == nullptr || store.size < sizeof(StatsHeader)) {
+        stats_store_unmap(store);
+        return false;
+    }
+
+    // The sections must add up to exactly the file
+    const StatsHeader* header = (const StatsHeader*)store.base;
+    uint64_t expected = sizeof(StatsHeader);
+    for (int cat = 1; cat <= 5; cat++) expected += (uint64_t)header->questions[cat] * sizeof(QuestionStats);
+    if (memcmp(header->magic, "QSTS", 4) != 0 || header->version != statsversion || expected != store.size) {
+        stats_store_unmap(store);
+        return false;
+    }
+
+    store.header = (StatsHeader*)store.base;
+    char* section = store.base + sizeof(StatsHeader);
+    for (int cat = 1; cat <= 5; cat++) {
+        store.questions[cat] = (QuestionStats*)section;
+        section += store.header->questions[cat] * sizeof(QuestionStats);
+    }
+    return true;
+}
+
+// ---------- Unmap the statistics table ----------
+void stats_store_unmap(StatsStore& store) {
+    if (store.base != nullptr) UnmapViewOfFile(store.base);
+    if (store.mapping != NULL) CloseHandle(store.mapping);
+    if (store.file != INVALID_HANDLE_VALUE) CloseHandle(store.file);
+    store.file = INVALID_HANDLE_VALUE;
+    store.mapping = NULL;
+    store.base = nullptr;
+    store.size = 0;
+    store.header = nullptr;
+    fill_n(store.questions, 6, nullptr);
+}
+
+// ---------- Close the statistics table ----------
+void stats_store_close(StatsStore& store) {
+    if (store.worker.joinable()) {
+        {
+            lock_guard<mutex> lock(store.lock);
+            store.stopping = true;
+        }
+        store.wake.notify_one();
+        store.worker.join();
+    }
+    if (store.base != nullptr) FlushViewOfFile(store.base, 0);
+    stats_store_unmap(store);
+}
+
+// ---------- Statistics sync loop ----------
+void stats_sync_loop(StatsStore& store) {
+    trace_thread_name("stats sync");
+    unique_lock<mutex> lock(store.lock);
+    while (!store.stopping) {
+        store.wake.wait_for(lock, chrono::milliseconds(store.interval_ms));
+        lock.unlock();
+        FlushViewOfFile(store.base, 0);
+        lock.lock();
+    }
+}
+
+// ---------- A question's counters ----------
+QuestionStats* find_question_stats(StatsStore& store, int cat, int id) {
+    if (store.base == nullptr || cat < 1 || cat > 5 || id < 0 || (uint32_t)id >= store.header->questions[cat]) {
+        return nullptr;
+    }
+    return &store.questions[cat][id];
+}
+
+// ---------- Count a closed question ----------
+void record_question_stats(StatsStore& store, int cat, int id, AnswerResult result, uint64_t latency_us) {
+    QuestionStats* stats = find_question_stats(store, cat, id);
+    if (stats == nullptr) return;
+    switch (result) {
+    case RESULT_CORRECT: stats->correct.fetch_add(1, memory_order_relaxed); break;
+    case RESULT_WRONG: stats->wrong.fetch_add(1, memory_order_relaxed); break;
+    case RESULT_TIMEOUT: stats->timeouts.fetch_add(1, memory_order_relaxed); break;
+    case RESULT_SKIPPED: stats->skipped.fetch_add(1, memory_order_relaxed); break;
+    case RESULT_REPLACED: stats->replaced.fetch_add(1, memory_order_relaxed); break;
+    default: return;
+    }
+    if (latency_us != 0) stats->answer_us.fetch_add(latency_us, memory_order_relaxed);
+}
+
+// ---------- Hardest and easiest questions ----------
+int run_question_stats(int count, int cat) {
+    // Read-only, so a running game or server can keep counting into the file meanwhile
+    StatsStore store;
+    if (!stats_store_map(store, false)) {
+        uint64_t size, time;
+        if (!get_file_stamp(store.path, size, time)) cout << "No question statistics in " << store.path << " yet\n";
+        else cout << "Cannot read " << store.path << " (in use or damaged)\n";
+        return 1;
+    }
+    load_bank_cache();  // For the question text; the counters are read where they lie
+
+    // Ranked by the share of answers that were wrong or timed out
+    vector<StatsRank> ranks;
+    uint64_t shown = 0, answers = 0;
+    for (int c = 1; c <= 5; c++) {
+        if (cat >= 1 && cat <= 5 && c != cat) continue;
+        for (uint32_t id = 0; id < store.header->questions[c]; id++) {
+            const QuestionStats& q = store.questions[c][id];
+            uint32_t missed = q.wrong.load(memory_order_relaxed) + q.timeouts.load(memory_order_relaxed);
+            uint32_t answered = missed + q.correct.load(memory_order_relaxed);
+            shown += q.shown.load(memory_order_relaxed);
+            answers += answered;
+            if (answered >= statsminanswers) ranks.push_back(StatsRank{ (double)missed / answered, answered, c, (int)id });
+        }
+    }
+    sort(ranks.begin(), ranks.end(), [](const StatsRank& a, const StatsRank& b) {
+        return a.missed != b.missed ? a.missed > b.missed : a.answers > b.answers;
+    });
+    cout << shown << " questions shown, " << answers << " answered; " << ranks.size() << " with " <<
+        statsminanswers << "+ answers are ranked\n";
+
+    // The easiest list stops where the hardest one ends when there are few ranked questions
+    int listed[2];
+    listed[0] = min(max(count, 0), (int)ranks.size());
+    listed[1] = min(max(count, 0), (int)ranks.size() - listed[0]);
+    for (int pass = 0; pass < 2; pass++) {
+        cout << (pass == 0 ? "\nHardest questions:\n" : "\nEasiest questions:\n");
+        for (int i = 0; i < listed[pass]; i++) {
+            const StatsRank& rank = ranks[pass == 0 ? i : ranks.size() - 1 - i];
+            const QuestionStats& q = store.questions[rank.cat][rank.id];
+            uint32_t timed = q.correct.load(memory_order_relaxed) + q.wrong.load(memory_order_relaxed);
+            char line[200];
+            sprintf_s(line, "%3.0f%% missed of %u (%u shown, %u timed out, 50/50 %u, skipped %u, replaced %u, %.2f s average)",
+                rank.missed * 100, rank.answers, q.shown.load(memory_order_relaxed), q.timeouts.load(memory_order_relaxed),
+                q.fifty_fifty.load(memory_order_relaxed), q.skipped.load(memory_order_relaxed),
+                q.replaced.load(memory_order_relaxed),
+                timed > 0 ? q.answer_us.load(memory_order_relaxed) / 1e6 / timed : 0.0);
+            cout << "  " << category_name(rank.cat) << " #" << rank.id << ": " << line << "\n";
+
+            shared_ptr<const QuestionBank> bank = acquire_bank(rank.cat);
+            if (bank != nullptr && rank.id < bank->count) {
+                QuestionView view = get_question(*bank, rank.id);
+                cout << "    (" << difficulty_name(view.difficulty) << ") " << string_view(view.text[0], view.length[0]) << "\n";
+            }
+        }
+    }
+
+    stats_store_unmap(store);
+    release_bank_cache();
+    return 0;
+}
+
+// ---------- Open the rating and statistics tables ----------
+bool open_question_tables() {
+    shared_ptr<const QuestionBank> held[6];
+    const QuestionBank* banks[6] = {};
+    for (int cat = 1; cat <= 5; cat++) {
+        held[cat] = acquire_bank(cat);
+        banks[cat] = held[cat].get();
+    }
+    bool rated = rating_store_open(ratings, "ratings.qrt", banks);
+    return stats_store_open(question_stats, banks) && rated;
+}
+
+// ---------- Close the rating and statistics tables ----------
+void close_question_tables() {
+    stats_store_close(question_stats);
+    rating_store_close(ratings);
+}
+
+// ======================= BACKGROUND WRITER ============================
+
+// ---------- Queue text for a file ----------
+void writer_enqueue(WriterFile file, string text) {
+    WriteRecord* rec = new WriteRecord;
+    rec->file = file;
+    rec->text = move(text);
+    writer_push(rec);
+}
+
+// ---------- Queue a session for the session log ----------
+void writer_enqueue_session(SessionRow row) {
+    WriteRecord* rec = new WriteRecord;
+    rec->file = WRITER_SESSIONS;
+    rec->row = move(row);
+    writer_push(rec);
+}
+
+// ---------- Push a record (any thread, lock-free) ----------
+void writer_push(WriteRecord* rec) {
+    writer.enqueued.fetch_add(1, memory_order_relaxed);
+    WriteRecord* prev = writer.head.exchange(rec, memory_order_acq_rel);
+    prev->next.store(rec, memory_order_release);
+}
+
+// ---------- Pop the oldest record (writer thread only) ----------
+// Returns nullptr when the queue is empty or a producer is between its
+// exchange and its link; the record then shows up on the next commit.
+WriteRecord* writer_pop() {
+    WriteRecord* tail = writer.tail;
+    WriteRecord* next = tail->next.load(memory_order_acquire);
+    if (tail == &writer.stub) {
+        if (next == nullptr) return nullptr;
+        writer.tail = next;
+        tail = next;
+        next = next->next.load(memory_order_acquire);
+    }
+    if (next != nullptr) {
+        writer.tail = next;
+        return tail;
+    }
+    if (tail != writer.head.load(memory_order_acquire)) return nullptr;
+
+    // tail is the last record: put the stub behind it so it can be handed out
+    writer.stub.next.store(nullptr, memory_order_relaxed);
+    WriteRecord* prev = writer.head.exchange(&writer.stub, memory_order_acq_rel);
+    prev->next.store(&writer.stub, memory_order_release);
+    next = tail->next.load(memory_order_acquire);
+    if (next != nullptr) {
+        writer.tail = next;
+        return tail;
+    }
+    return nullptr;
+}
+
+// ---------- Write one batch per file ----------
+int writer_commit() {
+    TraceSpan span("writer_commit", "io");
+    string batch[writerfiles];
+    vector<SessionRow> sessions;
+    int count = 0;
+
+    // Text gets text-mode line endings, as the old ofstream appends produced
+    bool history_changed = false;
+    while (WriteRecord* rec = writer_pop()) {
+        if (rec->file == WRITER_SESSIONS) {
+            sessions.push_back(move(rec->row));
+        } else if (rec->file == WRITER_HISTORY) {
+            seen_store_add(history, rec->text, rec->ids);
+            history_changed = true;
+        } else {
+            for (char c : rec->text) {
+                if (c == '\n') batch[rec->file] += '\r';
+                batch[rec->file] += c;
+            }
+        }
+        delete rec;
+        count++;
+    }
+    if (count == 0) return 0;
+
+    // Every session in the commit goes into one columnar block
+    if (!sessions.empty()) encode_log_block(sessions, batch[WRITER_SESSIONS]);
+    if (history_changed) {
+        lock_guard<mutex> lock(history.lock);
+        history.data.flush();
+        history.index.flush();
+    }
+
+    for (int f = 0; f < writerfiles; f++) {
+        if (batch[f].empty()) continue;
+        if (writer.files[f] == INVALID_HANDLE_VALUE) {
+            writer.files[f] = CreateFileA(writer.paths[f].c_str(), FILE_APPEND_DATA, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+            if (writer.files[f] == INVALID_HANDLE_VALUE) {
+                cout << "Error opening " << writer.paths[f] << "\n";
+                continue;
+            }
+        }
+        DWORD done = 0;
+        WriteFile(writer.files[f], batch[f].data(), (DWORD)batch[f].size(), &done, NULL);
+        if (writer.fsync_commits) FlushFileBuffers(writer.files[f]);
+    }
+
+    writer.commits++;
+    writer.written.fetch_add(count, memory_order_release);
+    return count;
+}
+
+// ---------- Writer thread ----------
+void writer_loop() {
+    trace_thread_name("writer");
+    while (true) {
+        bool stopping;
+        {
+            unique_lock<mutex> lock(writer.lock);
+            writer.wake.wait_for(lock, chrono::milliseconds(writer.flush_ms),
+                [] { return writer.stopping || writer.sync_requested; });
+            writer.sync_requested = false;
+            stopping = writer.stopping;
+        }
+
+        writer_commit();
+        {
+            lock_guard<mutex> lock(writer.lock);
+            writer.done.notify_all();
+        }
+
+        if (stopping) {
+            // Drain: wait out producers that are halfway through a push
+            while (writer.written.load() < writer.enqueued.load()) {
+                if (writer_commit() == 0) this_thread::yield();
+            }
+            return;
+        }
+    }
+}
+
+// ---------- Start the writer thread ----------
+void writer_start() {
+    if (writer.worker.joinable()) return;
+    if (writer.flush_ms < 1) writer.flush_ms = 1;
+    writer.stopping = false;
+    writer.worker = thread(writer_loop);
+}
+
+// ---------- Drain the queue and stop the writer thread ----------
+void writer_stop() {
+    if (!writer.worker.joinable()) return;
+    {
+        lock_guard<mutex> lock(writer.lock);
+        writer.stopping = true;
+    }
+    writer.wake.notify_one();
+    writer.worker.join();
+
+    for (int f = 0; f < writerfiles; f++) {
+        if (writer.files[f] != INVALID_HANDLE_VALUE) CloseHandle(writer.files[f]);
+        writer.files[f] = INVALID_HANDLE_VALUE;
+    }
+}
+
+// ---------- Wait for everything queued so far ----------
+void writer_sync() {
+    TraceSpan span("writer_sync", "io");
+    uint64_t target = writer.enqueued.load();
+    if (!writer.worker.joinable()) {
+        // No writer thread (yet): commit on the caller's thread
+        while (writer.written.load() < target) {
+            if (writer_commit() == 0) this_thread::yield();
+        }
+        return;
+    }
+
+    unique_lock<mutex> lock(writer.lock);
+    writer.sync_requested = true;
+    writer.wake.notify_one();
+    writer.done.wait(lock, [target] { return writer.written.load() >= target; });
+}
+
+// ======================= ANSWER METRICS ============================
+
+// ---------- This thread's metrics block ----------
+ThreadMetrics& local_metrics() {
+    if (thread_metrics == nullptr) {
+        // Never freed, so a finished thread's counts stay in the totals
+        thread_metrics = new ThreadMetrics();
+        ThreadMetrics* head = metrics_threads.load();
+        do {
+            thread_metrics->next = head;
+        } while (!metrics_threads.compare_exchange_weak(head, thread_metrics));
+    }
+    return *thread_metrics;
+}
+
+// ---------- Bump a counter this thread owns ----------
+void metric_add(atomic<uint64_t>& counter, uint64_t amount) {
+    // Only the owner writes, so a plain load and store is enough (no locked instruction)
+    counter.store(counter.load(memory_order_relaxed) + amount, memory_order_relaxed);
+}
+
+// ---------- Histogram bucket of a latency ----------
+int latency_bucket(uint64_t us) {
+    // Below 64 us a bucket per microsecond; above, 32 per power of two
+    int msb = 0;
+    for (int step = 32; step > 0; step >>= 1) {
+        if (us >> (msb + step)) msb += step;
+    }
+    int shift = max(0, msb - latencysubbits);
+    if (shift > latencyshifts) return latencybuckets - 1;
+    return (shift << latencysubbits) + (int)(us >> shift);
+}
+
+// ---------- Smallest latency in a bucket ----------
+uint64_t latency_bucket_floor(int bucket) {
+    if (bucket < 2 << latencysubbits) return (uint64_t)bucket;
+    int shift = (bucket >> latencysubbits) - 1;
+    return (uint64_t)(bucket - (shift << latencysubbits)) << shift;
+}
+
+// ---------- Record a closed question ----------
+void record_question_metrics(int cat, AnswerResult result, uint64_t latency_us) {
+    ThreadMetrics& m = local_metrics();
+    metric_add(m.results[cat - 1][result], 1);
+    if (result == RESULT_CORRECT || result == RESULT_WRONG) {
+        metric_add(m.latency[cat - 1][latency_bucket(latency_us)], 1);
+        metric_add(m.latency_sum_us[cat - 1], latency_us);
+    }
+}
+
+// ---------- Record a used lifeline ----------
+void record_lifeline_metric(int cat, int lifeline) {
+    metric_add(local_metrics().lifelines[cat - 1][lifeline - LIFELINE_5050], 1);
+}
+
+// ---------- Record a finished session ----------
+void record_session_metric(int cat) {
+    metric_add(local_metrics().sessions[cat - 1], 1);
+}
+
+// ---------- Sum every thread's metrics ----------
+void merge_metrics(MetricsSnapshot& total) {
+    total = MetricsSnapshot();
+    total.latency.assign((size_t)5 * latencybuckets, 0);
+    for (ThreadMetrics* m = metrics_threads.load(); m != nullptr; m = m->next) {
+        for (int c = 0; c < 5; c++) {
+            for (int b = 0; b < latencybuckets; b++) total.latency[(size_t)c * latencybuckets + b] += m->latency[c][b].load(memory_order_relaxed);
+            total.latency_sum_us[c] += m->latency_sum_us[c].load(memory_order_relaxed);
+            for (int r = 0; r < 6; r++) total.results[c][r] += m->results[c][r].load(memory_order_relaxed);
+            for (int l = 0; l < 4; l++) total.lifelines[c][l] += m->lifelines[c][l].load(memory_order_relaxed);
+            total.sessions[c] += m->sessions[c].load(memory_order_relaxed);
+        }
+    }
+}
+
+// ---------- Metrics in Prometheus text format ----------
+string metrics_text() {
+    MetricsSnapshot s;
+    merge_metrics(s);
+
+    // Exported bucket bounds in seconds; an HDR bucket is counted under the first bound
+    // its largest latency fits, so the counts are exact to within a bucket (about 3%)
+    const double bounds[] = { 0.5, 1, 2, 3, 5, 7.5, 10, 12.5, 15, 20, 30, 60 };
+    const char* results[] = { "", "correct", "wrong", "timeout", "skipped", "replaced" };
+    const char* lifelines[] = { "50_50", "skip", "replace", "extra_time" };
+    const double quantiles[] = { 0.5, 0.9, 0.99 };
+    char number[64];
+    string out;
+
+    out += "# HELP quiz_answer_latency_seconds Time from showing a question to its answer\n";
+    out += "# TYPE quiz_answer_latency_seconds histogram\n";
+    for (int c = 0; c < 5; c++) {
+        string label = "category=\"" + category_name(c + 1) + "\"";
+        const uint64_t* buckets = &s.latency[(size_t)c * latencybuckets];
+        uint64_t count = 0;
+        int b = 0;
+        for (double bound : bounds) {
+            uint64_t bound_us = (uint64_t)(bound * 1e6);
+            for (; b < latencybuckets && latency_bucket_floor(b + 1) - 1 <= bound_us; b++) count += buckets[b];
+            sprintf_s(number, "%g", bound);
+            out += "quiz_answer_latency_seconds_bucket{" + label + ",le=\"" + number + "\"} " + to_string(count) + "\n";
+        }
+        for (; b < latencybuckets; b++) count += buckets[b];
+        out += "quiz_answer_latency_seconds_bucket{" + label + ",le=\"+Inf\"} " + to_string(count) + "\n";
+        sprintf_s(number, "%.6f", s.latency_sum_us[c] / 1e6);
+        out += "quiz_answer_latency_seconds_sum{" + label + "} " + number + "\n";
+        out += "quiz_answer_latency_seconds_count{" + label + "} " + to_string(count) + "\n";
+    }
+
+    out += "# HELP quiz_answer_latency_quantile_seconds Answer latency percentiles from the full-resolution histogram\n";
+    out += "# TYPE quiz_answer_latency_quantile_seconds gauge\n";
+    for (int c = 0; c < 5; c++) {
+        const uint64_t* buckets = &s.latency[(size_t)c * latencybuckets];
+        uint64_t count = 0;
+        for (int b = 0; b < latencybuckets; b++) count += buckets[b];
+        if (count == 0) continue;
+        for (double q : quantiles) {
+            // Middle of the bucket holding the q-th answer
+            uint64_t rank = (uint64_t)(q * (count - 1)) + 1, seen = 0;
+            int b = 0;
+            while ((seen += buckets[b]) < rank) b++;
+            double us = (latency_bucket_floor(b) + latency_bucket_floor(b + 1)) / 2.0;
+            char value[32];
+            sprintf_s(number, "%g", q);
+            sprintf_s(value, "%g", us / 1e6);
+            out += "quiz_answer_latency_quantile_seconds{category=\"" + category_name(c + 1) + "\",quantile=\"" +
+                number + "\"} " + value + "\n";
+        }
+    }
+
+    out += "# HELP quiz_questions_total Questions closed, by how they were closed\n";
+    out += "# TYPE quiz_questions_total counter\n";
+    for (int c = 0; c < 5; c++) {
+        for (int r = RESULT_CORRECT; r <= RESULT_REPLACED; r++) {
+            out += "quiz_questions_total{category=\"" + category_name(c + 1) + "\",result=\"" + results[r] + "\"} " +
+                to_string(s.results[c][r]) + "\n";
+        }
+    }
+
+    out += "# HELP quiz_lifelines_total Lifelines used\n";
+    out += "# TYPE quiz_lifelines_total counter\n";
+    for (int c = 0; c < 5; c++) {
+        for (int l = 0; l < 4; l++) {
+            out += "quiz_lifelines_total{category=\"" + category_name(c + 1) + "\",lifeline=\"" + lifelines[l] + "\"} " +
+                to_string(s.lifelines[c][l]) + "\n";
+        }
+    }
+
+    out += "# HELP quiz_sessions_total Sessions finished\n";
+    out += "# TYPE quiz_sessions_total counter\n";
+    for (int c = 0; c < 5; c++) {
+        out += "quiz_sessions_total{category=\"" + category_name(c + 1) + "\"} " + to_string(s.sessions[c]) + "\n";
+    }
+    return out;
+}
+
+// ---------- Dump the metrics file ----------
+bool write_metrics_file() {
+    // Written aside and renamed over the old dump, so a scraper never reads half a file
+    string temp = metrics.path + ".tmp";
+    ofstream fout(temp, ios::binary | ios::trunc);
+    if (!fout.is_open()) return false;
+    fout << metrics_text();
+    fout.close();
+    if (fout.fail()) return false;
+    return MoveFileExA(temp.c_str(), metrics.path.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+}
+
+// ---------- Metrics dump loop ----------
+void metrics_loop() {
+    trace_thread_name("metrics");
+    unique_lock<mutex> lock(metrics.lock);
+    while (!metrics.stopping) {
+        metrics.wake.wait_for(lock, chrono::milliseconds(metrics.interval_ms));
+        lock.unlock();
+        write_metrics_file();
+        lock.lock();
+    }
+}
+
+// ---------- Start the metrics dump thread ----------
+void metrics_start() {
+    if (metrics.path.empty() || metrics.worker.joinable()) return;
+    if (metrics.interval_ms < 100) metrics.interval_ms = 100;
+    metrics.stopping = false;
+    metrics.worker = thread(metrics_loop);
+}
+
+// ---------- Stop the metrics dump thread (after a last dump) ----------
+void metrics_stop() {
+    if (!metrics.worker.joinable()) return;
+    {
+        lock_guard<mutex> lock(metrics.lock);
+        metrics.stopping = true;
+    }
+    metrics.wake.notify_one();
+    metrics.worker.join();
+}
+
+// ======================= SESSION TRACING ============================
+
+// ---------- This thread's trace buffer ----------
+TraceBuffer* local_trace_buffer() {
+    if (thread_trace == nullptr) {
+        thread_trace = new TraceBuffer();
+        thread_trace->tid = tracer.next_tid.fetch_add(1);
+        TraceBuffer* head = tracer.buffers.load();
+        do {
+            thread_trace->next = head;
+        } while (!tracer.buffers.compare_exchange_weak(head, thread_trace));
+    }
+    return thread_trace;
+}
+
+// ---------- Name this thread on the timeline ----------
+void trace_thread_name(const char* name) {
+    // Every thread names itself as it starts, so its ring is made before any question opens
+    if (tracer.enabled.load(memory_order_relaxed)) local_trace_buffer()->name = name;
+}
+
+// ---------- Open a span ----------
+TraceSpan::TraceSpan(const char* span_name, const char* span_category) {
+    if (!tracer.enabled.load(memory_order_relaxed)) return;
+    name = span_name;
+    category = span_category;
+    start = chrono::steady_clock::now();
+}
+
+// ---------- Close a span into the ring ----------
+TraceSpan::~TraceSpan() {
+    if (name == nullptr) return;
+    auto end = chrono::steady_clock::now();
+    TraceBuffer* buffer = local_trace_buffer();
+    uint64_t n = buffer->written.load(memory_order_relaxed);
+    TraceEvent& event = buffer->events[n % traceevents];
+    event.name = name;
+    event.category = category;
+    event.start_ns = chrono::duration_cast<chrono::nanoseconds>(start - tracer.epoch).count();
+    event.duration_ns = chrono::duration_cast<chrono::nanoseconds>(end - start).count();
+    buffer->written.store(n + 1, memory_order_release);
+}
+
+// ---------- Turn tracing on ----------
+void trace_start(string path) {
+    tracer.path = path;
+    tracer.epoch = chrono::steady_clock::now();
+    tracer.enabled = true;
+    trace_thread_name("main");
+    atexit([] { write_trace_file(); });
+}
+
+// ---------- Dump every ring as Chrome trace JSON ----------
+bool write_trace_file() {
+    if (!tracer.enabled.exchange(false)) return false;
+    ofstream fout(tracer.path, ios::binary | ios::trunc);
+    if (!fout.is_open()) {
+        cout << "Error opening " << tracer.path << "\n";
+        return false;
+    }
+
+    // Complete ("X") events in microseconds; a full ring keeps its newest traceevents spans
+    char line[320];
+    uint64_t spans = 0, dropped = 0;
+    bool first = true;
+    fout << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+    for (TraceBuffer* buffer = tracer.buffers.load(); buffer != nullptr; buffer = buffer->next) {
+        sprintf_s(line, "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %u, \"args\": {\"name\": \"%s\"}}",
+            first ? "" : ",\n", buffer->tid, buffer->name != nullptr ? buffer->name : "thread");
+        fout << line;
+        first = false;
+
+        uint64_t written = buffer->written.load(memory_order_acquire);
+        uint64_t begin = written > (uint64_t)traceevents ? written - traceevents : 0;
+        dropped += begin;
+        for (uint64_t i = begin; i < written; i++) {
+            const TraceEvent& event = buffer->events[i % traceevents];
+            sprintf_s(line, ",\n{\"name\": \"%s\", \"cat\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %u, "
+                "\"ts\": %.3f, \"dur\": %.3f}", event.name, event.category, buffer->tid,
+                event.start_ns / 1000.0, event.duration_ns / 1000.0);
+            fout << line;
+            spans++;
+        }
+    }
+    fout << "\n]}\n";
+    fout.close();
+    cout << "Trace: " << spans << " spans written to " << tracer.path;
+    if (dropped > 0) cout << " (" << dropped << " older ones overwritten)";
+    cout << "\n";
+    return !fout.fail();
+}
+
+// ======================= LOGGING FUNCTIONS ============================
+
+// ---------- Save detailed quiz log to file ----------
+void save_quiz_log(string player, string category_str, string difficulty_str, int correct, int wrong, int total_score,
+    uint32_t outcomes) {
+    TraceSpan span("save_quiz_log", "io");
+    // One row of the columnar session log; the writer thread appends it
+    SessionRow row;
+    row.time = (int64_t)time(0);
+    row.player = move(player);
+    row.category = (uint8_t)category_from_name(category_str);
+    row.difficulty = (uint8_t)difficulty_from_name(difficulty_str);
+    row.correct = (uint8_t)correct;
+    row.wrong = (uint8_t)wrong;
+    row.score = (int16_t)total_score;
+    row.outcomes = outcomes;
+
+    writer_enqueue_session(move(row));
+}
+
+// ======================= SESSION LOG ============================
+
+// ---------- Append sessions as one columnar block ----------
+void encode_log_block(const vector<SessionRow>& rows, string& out) {
+    uint32_t n = (uint32_t)rows.size();
+
+    // Block-local player dictionary; rows store an index into it
+    unordered_map<string_view, uint32_t> ids;
+    vector<string_view> names;
+    vector<uint32_t> player(n);
+    for (uint32_t i = 0; i < n; i++) {
+        string_view name(rows[i].player.data(), min<size_t>(rows[i].player.size(), 65535));
+        auto found = ids.find(name);
+        if (found == ids.end()) {
+            found = ids.emplace(name, (uint32_t)names.size()).first;
+            names.push_back(name);
+        }
+        player[i] = found->second;
+    }
+
+    size_t dict_bytes = names.size() * sizeof(uint16_t);
+    for (string_view name : names) dict_bytes += name.size();
+    dict_bytes = (dict_bytes + 7) & ~(size_t)7;
+    size_t column_bytes = (size_t)n * (sizeof(int64_t) + 2 * sizeof(uint32_t) + sizeof(int16_t) + 4);
+    column_bytes = (column_bytes + 7) & ~(size_t)7;
+
+    LogBlockHeader header;
+    memcpy(header.magic, "QCLB", 4);
+    header.version = logversion;
+    header.rows = n;
+    header.players = (uint32_t)names.size();
+    header.dict_bytes = (uint32_t)dict_bytes;
+    header.block_bytes = (uint32_t)(sizeof(LogBlockHeader) + dict_bytes + column_bytes);
+
+    size_t start = out.size();
+    out.resize(start + header.block_bytes, '\0');
+    char* block = &out[start];
+    memcpy(block, &header, sizeof(header));
+
+    // Dictionary: all lengths, then all names
+    char* lengths = block + sizeof(LogBlockHeader);
+    char* text = lengths + names.size() * sizeof(uint16_t);
+    for (string_view name : names) {
+        uint16_t length = (uint16_t)name.size();
+        memcpy(lengths, &length, sizeof(length));
+        lengths += sizeof(length);
+        memcpy(text, name.data(), name.size());
+        text += name.size();
+    }
+
+    // Columns, widest first so each one stays naturally aligned
+    char* p = block + sizeof(LogBlockHeader) + dict_bytes;
+    for (uint32_t i = 0; i < n; i++, p += sizeof(int64_t)) memcpy(p, &rows[i].time, sizeof(int64_t));
+    memcpy(p, player.data(), n * sizeof(uint32_t));
+    p += n * sizeof(uint32_t);
+    for (uint32_t i = 0; i < n; i++, p += sizeof(uint32_t)) memcpy(p, &rows[i].outcomes, sizeof(uint32_t));
+    for (uint32_t i = 0; i < n; i++, p += sizeof(int16_t)) memcpy(p, &rows[i].score, sizeof(int16_t));
+    for (uint32_t i = 0; i < n; i++) *p++ = (char)rows[i].category;
+    for (uint32_t i = 0; i < n; i++) *p++ = (char)rows[i].difficulty;
+    for (uint32_t i = 0; i < n; i++) *p++ = (char)rows[i].correct;
+    for (uint32_t i = 0; i < n; i++) *p++ = (char)rows[i].wrong;
+}
+
+// ---------- Validate one block and locate its columns ----------
+bool decode_log_block(const char* data, uint64_t available, LogColumns& cols) {
+    if (available < sizeof(LogBlockHeader)) return false;
+    const LogBlockHeader* header = (const LogBlockHeader*)data;
+    if (memcmp(header->magic, "QCLB", 4) != 0 || header->version != logversion) return false;
+
+    uint64_t rows = header->rows;
+    uint64_t minimum = sizeof(LogBlockHeader) + (uint64_t)header->dict_bytes +
+        rows * (sizeof(int64_t) + 2 * sizeof(uint32_t) + sizeof(int16_t) + 4);
+    if (header->block_bytes % 8 != 0 || header->dict_bytes % 8 != 0 ||
+        header->block_bytes < minimum || header->block_bytes > available) return false;
+
+    cols.header = header;
+    cols.name_length = (const uint16_t*)(data + sizeof(LogBlockHeader));
+    cols.names = (const char*)(cols.name_length + header->players);
+    uint64_t dict = (uint64_t)header->players * sizeof(uint16_t);
+    for (uint32_t i = 0; i < header->players && dict <= header->dict_bytes; i++) dict += cols.name_length[i];
+    if (dict > header->dict_bytes) return false;
+
+    const char* p = data + sizeof(LogBlockHeader) + header->dict_bytes;
+    cols.time = (const int64_t*)p;
+    p += rows * sizeof(int64_t);
+    cols.player = (const uint32_t*)p;
+    p += rows * sizeof(uint32_t);
+    cols.outcomes = (const uint32_t*)p;
+    p += rows * sizeof(uint32_t);
+    cols.score = (const int16_t*)p;
+    p += rows * sizeof(int16_t);
+    cols.category = (const uint8_t*)p;
+    cols.difficulty = cols.category + rows;
+    cols.correct = cols.difficulty + rows;
+    cols.wrong = cols.correct + rows;
+
+    // Every row must name a dictionary entry
+    uint32_t bad = 0;
+    for (uint64_t i = 0; i < rows; i++) bad |= cols.player[i] >= header->players;
+    return bad == 0;
+}
+
+// ---------- Names of a block's player dictionary ----------
+void log_block_names(const LogColumns& cols, vector<string_view>& names) {
+    names.resize(cols.header->players);
+    const char* text = cols.names;
+    for (uint32_t i = 0; i < cols.header->players; i++) {
+        names[i] = string_view(text, cols.name_length[i]);
+        text += cols.name_length[i];
+    }
+}
+
+// ---------- Map a session log read-only ----------
+bool map_session_log(string name, HANDLE& file, HANDLE& mapping, const char*& base, uint64_t& size) {
+    // The writer may be appending; the mapping sees the file as it is now
+    file = CreateFileA(name.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER length;
+    if (!GetFileSizeEx(file, &length) || length.QuadPart == 0) {
+        CloseHandle(file);
+        return false;
+    }
+    size = (uint64_t)length.QuadPart;
+
+    mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping == NULL) {
+        CloseHandle(file);
+        return false;
+    }
+    base = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (base == nullptr) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+    return true;
+}
+
+void unmap_session_log(HANDLE file, HANDLE mapping, const char* base) {
+    UnmapViewOfFile(base);
+    CloseHandle(mapping);
+    CloseHandle(file);
+}
+
+// ---------- Parse a text log timestamp ----------
+bool parse_log_datetime(string_view text, int64_t& time) {
+    static const char months[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+    string buffer(text);
+    tm t;
+    memset(&t, 0, sizeof(t));
+
+    // Current format, from get_current_datetime()
+    if (sscanf_s(buffer.c_str(), "%d-%d-%d %d:%d:%d", &t.tm_year, &t.tm_mon, &t.tm_mday,
+        &t.tm_hour, &t.tm_min, &t.tm_sec) != 6) {
+        // Old format, __DATE__ followed by __TIME__ ("Oct 16 202612:34:56")
+        if (buffer.size() < 4) return false;
+        const char* month = strstr(months, buffer.substr(0, 3).c_str());
+        if (month == nullptr || (month - months) % 3 != 0) return false;
+        if (sscanf_s(buffer.c_str() + 3, "%d %4d%d:%d:%d", &t.tm_mday, &t.tm_year,
+            &t.tm_hour, &t.tm_min, &t.tm_sec) != 5) return false;
+        t.tm_mon = 1 + (int)(month - months) / 3;
+    }
+
+    t.tm_year -= 1900;
+    t.tm_mon -= 1;
+    t.tm_isdst = -1;
+    time_t result = mktime(&t);
+    if (result == (time_t)-1) return false;
+    time = (int64_t)result;
+    return true;
+}
+
+// ---------- Import the old text log ----------
+int run_log_import(string source, string target) {
+    ifstream fin(source);
+    if (!fin.is_open()) {
+        cout << "Error opening " << source << "\n";
+        return 1;
+    }
+    ofstream fout(target, ios::binary | ios::app);
+    if (!fout.is_open()) {
+        cout << "Error opening " << target << "\n";
+        return 1;
+    }
+
+    // Each entry runs from "Player:" to "Total Score:"; per-question outcomes were never logged
+    vector<SessionRow> rows;
+    string block, line;
+    SessionRow row;
+    bool in_entry = false, valid = false;
+    int64_t imported = 0, skipped = 0;
+    while (getline(fin, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        string_view text(line);
+        int value = 0;
+
+        if (text.substr(0, 8) == "Player: ") {
+            if (in_entry) skipped++;
+            row = SessionRow();
+            row.player = string(text.substr(8));
+            in_entry = valid = true;
+        } else if (!in_entry) {
+            continue;
+        } else if (text.substr(0, 13) == "Date & Time: ") {
+            valid = valid && parse_log_datetime(text.substr(13), row.time);
+        } else if (text.substr(0, 10) == "Category: ") {
+            row.category = (uint8_t)category_from_name(text.substr(10));
+            valid = valid && row.category != 0;
+        } else if (text.substr(0, 12) == "Difficulty: ") {
+            row.difficulty = (uint8_t)difficulty_from_name(text.substr(12));
+            valid = valid && row.difficulty != 0;
+        } else if (text.substr(0, 19) == "Questions Correct: ") {
+            valid = valid && parse_field(text.substr(19), 0, sessionquestions, value);
+            row.correct = (uint8_t)value;
+        } else if (text.substr(0, 17) == "Questions Wrong: ") {
+            valid = valid && parse_field(text.substr(17), 0, sessionquestions, value);
+            row.wrong = (uint8_t)value;
+        } else if (text.substr(0, 13) == "Total Score: ") {
+            string_view score = text.substr(13);
+            valid = valid && parse_field(score.substr(0, score.find('/')), -32768, 32767, value);
+            row.score = (int16_t)value;
+            in_entry = false;
+
+            if (!valid || row.time == 0) {
+                skipped++;
+                continue;
+            }
+            rows.push_back(move(row));
+            imported++;
+            if ((int)rows.size() == logblockrows) {
+                block.clear();
+                encode_log_block(rows, block);
+                fout.write(block.data(), block.size());
+                rows.clear();
+            }
+        }
+    }
+    if (in_entry) skipped++;
+    if (!rows.empty()) {
+        block.clear();
+        encode_log_block(rows, block);
+        fout.write(block.data(), block.size());
+    }
+    fout.close();
+
+    cout << "Imported " << imported << " sessions (" << skipped << " skipped) into " << target << "\n";
+    return 0;
+}
+
+// ---------- Group-by/aggregate report ----------
+int run_log_query(string keys, string name) {
+    auto started = chrono::steady_clock::now();
+
+    bool by_category = false, by_difficulty = false, by_day = false, by_player = false;
+    if (keys != "all") {
+        Record rec;
+        if (!split_record(keys, ',', rec, 1, 4)) {
+            cout << "Keys: category, difficulty, day, player (comma separated) or all\n";
+            return 1;
+        }
+        for (int f = 0; f < rec.count; f++) {
+            if (rec.fields[f] == "category") by_category = true;
+            else if (rec.fields[f] == "difficulty") by_difficulty = true;
+            else if (rec.fields[f] == "day") by_day = true;
+            else if (rec.fields[f] == "player") by_player = true;
+            else {
+                cout << "Unknown key " << rec.fields[f] << " (use category, difficulty, day, player or all)\n";
+                return 1;
+            }
+        }
+    }
+
+    HANDLE file, mapping;
+    const char* base;
+    uint64_t size;
+    if (!map_session_log(name, file, mapping, base, size)) {
+        cout << "No sessions in " << name << "\n";
+        return 1;
+    }
+
+    // Days are local dates at today's UTC offset
+    time_t now = time(0);
+    tm utc;
+    gmtime_s(&utc, &now);
+    utc.tm_isdst = -1;
+    int64_t utc_offset = (int64_t)now - (int64_t)mktime(&utc);
+
+    // Group key: player << 32 | day << 8 | category << 4 | difficulty
+    const uint32_t timeout_fields = 0x1B6DB6DB;  // RESULT_TIMEOUT in all ten fields
+    const uint32_t low_bits = 0x09249249;        // Lowest bit of each field
+    unordered_map<string, uint32_t> player_ids;
+    vector<string> player_names;
+    unordered_map<uint64_t, int> group_of;
+    vector<uint64_t> group_key;
+    vector<int64_t> sessions, score_sum, correct_sum, timeouts;
+    vector<int> min_score, max_score;
+
+    vector<uint64_t> key;
+    vector<int> group;
+    vector<uint32_t> remap;
+    vector<string_view> names;
+    uint64_t offset = 0, rows = 0, blocks = 0;
+    while (offset < size) {
+        LogColumns cols;
+        if (!decode_log_block(base + offset, size - offset, cols)) {
+            cout << "Stopped at a damaged or incomplete block at byte " << offset << "\n";
+            break;
+        }
+        uint32_t n = cols.header->rows;
+        offset += cols.header->block_bytes;
+        rows += n;
+        blocks++;
+
+        // Build the key column one source column at a time
+        key.assign(n, 0);
+        if (by_category)
+            for (uint32_t i = 0; i < n; i++) key[i] |= (uint64_t)cols.category[i] << 4;
+        if (by_difficulty)
+            for (uint32_t i = 0; i < n; i++) key[i] |= cols.difficulty[i];
+        if (by_day)
+            for (uint32_t i = 0; i < n; i++) key[i] |= (uint64_t)(((cols.time[i] + utc_offset) / 86400) & 0xFFFFFF) << 8;
+        if (by_player) {
+            log_block_names(cols, names);
+            remap.resize(names.size());
+            for (size_t p = 0; p < names.size(); p++) {
+                auto found = player_ids.emplace(string(names[p]), (uint32_t)player_names.size());
+                if (found.second) player_names.push_back(string(names[p]));
+                remap[p] = found.first->second;
+            }
+            for (uint32_t i = 0; i < n; i++) key[i] |= (uint64_t)remap[cols.player[i]] << 32;
+        }
+
+        // Key -> group; sessions are in time order, so equal keys come in runs
+        group.resize(n);
+        uint64_t last_key = ~0ull;
+        int last_group = -1;
+        for (uint32_t i = 0; i < n; i++) {
+            if (key[i] != last_key) {
+                last_key = key[i];
+                auto found = group_of.find(last_key);
+                if (found == group_of.end()) {
+                    found = group_of.emplace(last_key, (int)group_key.size()).first;
+                    group_key.push_back(last_key);
+                    sessions.push_back(0);
+                    score_sum.push_back(0);
+                    correct_sum.push_back(0);
+                    timeouts.push_back(0);
+                    min_score.push_back(INT_MAX);
+                    max_score.push_back(INT_MIN);
+                }
+                last_group = found->second;
+            }
+            group[i] = last_group;
+        }
+
+        // Aggregate column by column
+        for (uint32_t i = 0; i < n; i++) sessions[group[i]]++;
+        for (uint32_t i = 0; i < n; i++) {
+            int g = group[i], score = cols.score[i];
+            score_sum[g] += score;
+            if (score < min_score[g]) min_score[g] = score;
+            if (score > max_score[g]) max_score[g] = score;
+        }
+        for (uint32_t i = 0; i < n; i++) correct_sum[group[i]] += cols.correct[i];
+        for (uint32_t i = 0; i < n; i++) {
+            // Fields equal to RESULT_TIMEOUT become 000
+            uint32_t x = cols.outcomes[i] ^ timeout_fields;
+            uint32_t zero = ~(x | x >> 1 | x >> 2) & low_bits;
+            timeouts[group[i]] += bitset<32>(zero).count();
+        }
+    }
+    unmap_session_log(file, mapping, base);
+
+    // Rows ordered by category, difficulty, day, then player name
+    vector<uint32_t> name_rank(player_names.size());
+    vector<uint32_t> by_name(player_names.size());
+    for (uint32_t p = 0; p < by_name.size(); p++) by_name[p] = p;
+    sort(by_name.begin(), by_name.end(), [&](uint32_t a, uint32_t b) { return player_names[a] < player_names[b]; });
+    for (uint32_t r = 0; r < by_name.size(); r++) name_rank[by_name[r]] = r;
+
+    vector<pair<uint64_t, int>> order(group_key.size());
+    for (size_t g = 0; g < order.size(); g++) {
+        uint64_t k = group_key[g];
+        uint64_t rank = by_player ? name_rank[k >> 32] : 0;
+        order[g] = make_pair((k & 0xFF) << 56 | (k >> 8 & 0xFFFFFF) << 32 | rank, (int)g);
+    }
+    sort(order.begin(), order.end());
+
+    string out;
+    if (by_category) out += "Category\t";
+    if (by_difficulty) out += "Difficulty\t";
+    if (by_day) out += "Day\t";
+    if (by_player) out += "Player\t";
+    out += "Sessions\tAvg Score\tMin\tMax\tAvg Correct\tTimeouts\n";
+    char line[160];
+    for (auto& entry : order) {
+        int g = entry.second;
+        uint64_t k = group_key[g];
+        if (by_category) (out += category_name((int)(k >> 4 & 0xF))) += '\t';
+        if (by_difficulty) (out += difficulty_name((int)(k & 0xF))) += '\t';
+        if (by_day) (out += format_day((int64_t)(k >> 8 & 0xFFFFFF))) += '\t';
+        if (by_player) (out += player_names[k >> 32]) += '\t';
+        sprintf_s(line, "%lld\t%.2f\t%d\t%d\t%.2f\t%lld\n", (long long)sessions[g],
+            (double)score_sum[g] / sessions[g], min_score[g], max_score[g],
+            (double)correct_sum[g] / sessions[g], (long long)timeouts[g]);
+        out += line;
+    }
+    cout << out;
+
+    double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - started).count();
+    cout << "\n" << rows << " sessions in " << blocks << " blocks, " << ms << " ms\n";
+    return 0;
+}
+
+// ---------- Print sessions in the old text format ----------
+int run_log_dump(string name) {
+    HANDLE file, mapping;
+    const char* base;
+    uint64_t size;
+    if (!map_session_log(name, file, mapping, base, size)) {
+        cout << "No sessions in " << name << "\n";
+        return 1;
+    }
+
+    static const char outcome_letters[] = "-CWTSR";
+    vector<string_view> names;
+    uint64_t offset = 0;
+    string out;
+    while (offset < size) {
+        LogColumns cols;
+        if (!decode_log_block(base + offset, size - offset, cols)) {
+            out += "Stopped at a damaged or incomplete block at byte " + to_string(offset) + "\n";
+            break;
+        }
+        offset += cols.header->block_bytes;
+        log_block_names(cols, names);
+
+        for (uint32_t i = 0; i < cols.header->rows; i++) {
+            string answers;
+            for (int q = 0; q < sessionquestions; q++) {
+                uint32_t result = cols.outcomes[i] >> (q * outcomebits) & ((1u << outcomebits) - 1);
+                answers += result < 6 ? outcome_letters[result] : '?';
+            }
+
+            out += "========================================\n";
+            out += "Player: " + string(names[cols.player[i]]) + "\n";
+            out += "Date & Time: " + format_datetime(cols.time[i]) + "\n";
+            out += "Category: " + category_name(cols.category[i]) + "\n";
+            out += "Difficulty: " + difficulty_name(cols.difficulty[i]) + "\n";
+            out += "Questions Correct: " + to_string(cols.correct[i]) + "\n";
+            out += "Questions Wrong: " + to_string(cols.wrong[i]) + "\n";
+            out += "Total Score: " + to_string(cols.score[i]) + "/" + to_string(sessionquestions) + "\n";
+            out += "Answers: " + answers + " (C correct, W wrong, T timeout, S skipped, - not reached)\n";
+            out += "========================================\n\n";
+        }
+        if (out.size() > (1 << 20)) {
+            cout << out;
+            out.clear();
+        }
+    }
+    cout << out;
+    unmap_session_log(file, mapping, base);
+    return 0;
+}
+
+// ---------- Civil date for a day number ----------
+string format_day(int64_t day) {
+    // Days since 1970-01-01 to year/month/day (proleptic Gregorian)
+    int64_t z = day + 719468;
+    int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+    int64_t doe = z - era * 146097;
+    int64_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    int64_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    int64_t mp = (5 * doy + 2) / 153;
+    int d = (int)(doy - (153 * mp + 2) / 5 + 1);
+    int m = (int)(mp < 10 ? mp + 3 : mp - 9);
+    int y = (int)(yoe + era * 400 + (m <= 2));
+
+    char buffer[16];
+    sprintf_s(buffer, "%04d-%02d-%02d", y, m, d);
+    return string(buffer);
+}
+
+// ======================= SESSION REPLAY ============================
+
+// ---------- Queue a session's trace ----------
+void save_session_trace(const QuizSession& session, string_view player, int cat, const SessionSummary& summary) {
+    TraceSpan span("save_session_trace", "io");
+    // datetime|category difficulty timer|seed|bank size:time|seen history|inputs|score outcomes|player
+    const BankHeader* header = (const BankHeader*)session.qb->base;
+    char fields[160];
+    sprintf_s(fields, "|%d %d %d|%016llx|%llu:%llu|", cat, session.difficulty, session.base_timer,
+        (unsigned long long)session.seed, (unsigned long long)header->source_size,
+        (unsigned long long)header->source_time);
+    string line = get_current_datetime() + fields;
+
+    if (session.seen_count < 0) line += '-';
+    else line += session.seen_inverted ? "unseen" : "seen";
+    for (int i = 0; i < session.seen_count; i++) {
+        char token[16];
+        sprintf_s(token, " %d", session.seen_ids[i]);
+        line += token;
+    }
+    line += '|';
+    for (int i = 0; i < session.input_count; i++) {
+        char token[16];
+        sprintf_s(token, i > 0 ? " %c%d" : "%c%d", session.inputs[i].kind, session.inputs[i].value);
+        line += token;
+    }
+
+    sprintf_s(fields, "|%d %08x|", summary.score, summary.outcomes);
+    line += fields;
+    line.append(player.data(), player.size());
+    line += '\n';
+    writer_enqueue(WRITER_TRACES, move(line));
+}
+
+// ---------- Replay recorded sessions ----------
+int run_replay(string file, string filter) {
+    ifstream fin(file);
+    if (!fin.is_open()) {
+        cout << "Cannot open " << file << "\n";
+        return 1;
+    }
+    static const char* result_names[] = { "NONE", "CORRECT", "WRONG", "TIMEOUT", "SKIPPED", "REPLACED" };
+
+    QuestionBank banks[6];
+    QuizSession session;
+    string line;
+    int line_number = 0, replayed = 0, mismatched = 0;
+    while (getline(fin, line)) {
+        line_number++;
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+
+        // Seven fields, then the player name (which may itself contain '|')
+        string_view rest = line, fields[7];
+        bool complete = true;
+        for (int i = 0; i < 7 && complete; i++) {
+            size_t bar = rest.find('|');
+            if (bar == string_view::npos) complete = false;
+            else {
+                fields[i] = rest.substr(0, bar);
+                rest.remove_prefix(bar + 1);
+            }
+        }
+        string player(rest);
+        if (!filter.empty() && filter != player && filter != to_string(line_number)) continue;
+
+        int cat = 0, level = 0, timer = 0, recorded_score = 0;
+        unsigned int recorded_outcomes = 0;
+        uint64_t seed = 0, bank_size = 0, bank_time = 0;
+        string settings(fields[1]), result(fields[6]);
+        string_view stamp = fields[3];
+        size_t colon = stamp.find(':');
+        if (!complete || sscanf_s(settings.c_str(), "%d %d %d", &cat, &level, &timer) != 3 ||
+            sscanf_s(result.c_str(), "%d %x", &recorded_score, &recorded_outcomes) != 2 ||
+            cat < 1 || cat > 5 || level < 1 || level > adaptivelevel || colon == string_view::npos ||
+            from_chars(fields[2].data(), fields[2].data() + fields[2].size(), seed, 16).ec != errc() ||
+            from_chars(stamp.data(), stamp.data() + colon, bank_size).ec != errc() ||
+            from_chars(stamp.data() + colon + 1, stamp.data() + stamp.size(), bank_time).ec != errc()) {
+            cout << "Line " << line_number << ": malformed trace, skipped\n";
+            continue;
+        }
+
+        if (banks[cat].count == 0 && load_bank(banks[cat], category_file(cat)) == 0) {
+            cout << "Line " << line_number << ": cannot load " << category_file(cat) << "\n";
+            mismatched++;
+            continue;
+        }
+        const BankHeader* header = (const BankHeader*)banks[cat].base;
+        cout << "Session " << line_number << ": " << player << ", " << category_name(cat) << " " <<
+            difficulty_name(level) << ", " << fields[0] << ", seed " << fields[2] << "\n";
+        if (header->source_size != bank_size || header->source_time != bank_time) {
+            cout << "  (" << category_file(cat) << " has changed since this session; the replay may differ)\n";
+        }
+
+        // Rebuild as much of the history as the question order depended on
+        SeenBitmap seen;
+        const SeenBitmap* seen_arg = nullptr;
+        string_view history = fields[4];
+        if (history != "-" && level != adaptivelevel) {
+            const vector<int>& pool = banks[cat].pool[level];
+            bool inverted = history.substr(0, 6) == "unseen";
+            if (inverted || history.substr(0, 4) == "seen") {
+                SeenBitmap listed;
+                history.remove_prefix(inverted ? 6 : 4);
+                while (!history.empty()) {
+                    size_t space = history.find(' ');
+                    string_view token = history.substr(0, space);
+                    history.remove_prefix(space == string_view::npos ? history.size() : space + 1);
+                    uint32_t id = 0;
+                    if (from_chars(token.data(), token.data() + token.size(), id).ec == errc()) listed.add(id);
+                }
+                // "unseen": every other question of the pool was seen
+                if (!inverted) seen = move(listed);
+                else {
+                    for (int id : pool) {
+                        if (!listed.contains((uint32_t)id)) seen.add((uint32_t)id);
+                    }
+                }
+            } else {
+                // Older traces: one bit per pool entry, in hex words
+                for (size_t w = 0; w * 16 + 16 <= history.size(); w++) {
+                    uint64_t word = 0;
+                    from_chars(history.data() + w * 16, history.data() + w * 16 + 16, word, 16);
+                    for (int b = 0; b < 64; b++) {
+                        size_t i = w * 64 + b;
+                        if ((word >> b) & 1 && i < pool.size()) seen.add((uint32_t)pool[i]);
+                    }
+                }
+            }
+            seen_arg = &seen;
+        }
+        if (!session.start(banks[cat], level, timer, seen_arg, seed)) {
+            cout << "  Not enough questions for this difficulty\n";
+            mismatched++;
+            continue;
+        }
+
+        // Feed the inputs back in the order they were made
+        string_view inputs = fields[5];
+        int shown = 0;
+        bool extra = false;
+        while (!inputs.empty()) {
+            size_t space = inputs.find(' ');
+            string_view token = inputs.substr(0, space);
+            inputs.remove_prefix(space == string_view::npos ? inputs.size() : space + 1);
+            int value = 0;
+            if (token.size() < 2 || from_chars(token.data() + 1, token.data() + token.size(), value).ec != errc()) continue;
+            if (token[0] == 'Q') {
+                session.choose_question(value);  // Adaptive pick: ratings have moved on since
+                continue;
+            }
+
+            const PresentedQuestion* pq = session.present();
+            if (pq == nullptr) {
+                extra = true;
+                break;
+            }
+            if (session.presented_count != shown) {
+                shown = session.presented_count;
+                cout << "  Q" << pq->number + 1 << " (id " << pq->id << ") " <<
+                    string_view(pq->view.text[0], pq->view.length[0]) << "\n    ";
+                for (int i = 0; i < 4; i++) {
+                    cout << i + 1 << ") " << session.option_text(i) << (i == pq->correct_slot ? "*" : "") << "  ";
+                }
+                cout << "\n";
+            }
+
+            Feedback fb;
+            if (token[0] == 'A') fb = session.answer(value);
+            else if (token[0] == 'L') fb = session.use_lifeline(value);
+            else fb = session.tick(value);
+            cout << "    " << token << ": " << (fb.accepted ? result_names[fb.result] : "REJECTED");
+            if (fb.points != 0) cout << " " << (fb.points > 0 ? "+" : "") << fb.points;
+            cout << ", score " << session.score << "\n";
+        }
+        SessionSummary summary = session.finish();
+
+        bool match = !extra && summary.score == recorded_score && summary.outcomes == recorded_outcomes;
+        cout << "  Replayed score " << summary.score << ", recorded " << recorded_score << ": " <<
+            (match ? "MATCH" : "MISMATCH") << (extra ? " (inputs left after the last question)" : "") << "\n\n";
+        replayed++;
+        if (!match) mismatched++;
+    }
+
+    for (int cat = 1; cat <= 5; cat++) close_question_bank(banks[cat]);
+    cout << replayed << " session(s) replayed, " << mismatched << " mismatched\n";
+    return mismatched == 0 ? 0 : 1;
+}
+
+// ======================= REVIEW FUNCTIONS ============================
+
+// ---------- Review all incorrectly answered questions ----------
+void review_incorrect_questions(const QuizSession& session) {
+    int incorrect_count = session.incorrect_count;
+    if (incorrect_count == 0) {
+        cout << "\nGreat job! You didn't answer any questions incorrectly!\n";
+        cout << "Press Enter to continue...";
+        cin.get();
+        return;
+    }
+
+    ostringstream frame;
+    frame << "========================================\n";
+    frame << "       REVIEWING INCORRECT ANSWERS\n";
+    frame << "========================================\n";
+    frame << "You answered " << incorrect_count << " question(s) incorrectly.\n\n";
+    frame << "Press Enter to review them...";
+    screen_present(frame.str());
+    cin.get();
+
+    // Display each incorrect question with correct answer
+    for (int i = 0; i < incorrect_count; i++) {
+        display_review_question(*session.qb, session.incorrect[i], i + 1, incorrect_count);
+    }
+
+    cout << "\nReview complete!\n";
+    cout << "Press Enter to continue...";
+    cin.get();
+}
+
+// ---------- Display one question in review mode (no timer/lifelines) ----------
+void display_review_question(const QuestionBank& qb, const ReviewItem& item, int number, int total) {
+    // Rebuilt from the bank the session was played on, as it was displayed
+    QuestionView view = get_question(qb, item.id);
+    int order[4];
+    unpack_permutation(item.permutation, order);
+    string_view options[4];
+    for (int i = 0; i < 4; i++) {
+        options[i] = (item.removed >> i) & 1 ? "[REMOVED]" :
+            string_view(view.text[order[i] + 1], view.length[order[i] + 1]);
+    }
+
+    ostringstream frame;
+    frame << "Review Question " << number << " of " << total << "\n\n";
+    frame << string_view(view.text[0], view.length[0]) << "\n\n";
+    for (int i = 0; i < 4; i++)
+        frame << i + 1 << ") " << options[i] << "\n";
+
+    frame << "\n** Correct Answer: " << options[item.correct_pos] << " **\n";
+    frame << "\nPress Enter to continue...";
+    screen_present(frame.str());
+    cin.get();
+}
+
+// ======================= QUESTION DISPLAY ============================
+
+// ---------- Display a question with options and handle user interaction ----------
+void display_question(QuizSession& session, const PresentedQuestion& pq) {
+    TraceSpan span("display_question", "session");
+    // Display question and options
+    ostringstream frame;
+    frame << "Question " << pq.number + 1 << " of " << sessionquestions << "\n\n";
+    frame << string_view(pq.view.text[0], pq.view.length[0]) << "\n\n";
+    for (int i = 0; i < 4; i++)
+        frame << i + 1 << ") " << session.option_text(i) << "\n";
+
+    // Show available lifelines
+    frame << "\n--- Lifelines Available ---\n";
+    frame << "5) 50/50" << (session.lifeline_5050 ? " [AVAILABLE]" : " [USED]") << "\n";
+    frame << "6) Skip Question" << (session.lifeline_skip ? " [AVAILABLE]" : " [USED]") << "\n";
+    frame << "7) Replace Question" << (session.lifeline_replace ? " [AVAILABLE]" : " [USED]") << "\n";
+    frame << "8) Extra Time" << (session.lifeline_extratime ? " [AVAILABLE]" : " [USED]") << "\n";
+
+    int answer = 0;
+    Feedback fb;
+    frame << "\nYour answer (1-4) or lifeline (5-8): ";
+    screen_present(frame.str());
+
+    bool answered_in_time = get_answer_with_timer(session, answer, fb);
+
+    // Handle lifeline choices
+    bool timeout_shown = false;  // A lifeline's own time-up line replaces the generic one
+    if (answered_in_time && answer >= LIFELINE_5050 && answer <= LIFELINE_EXTRATIME) {
+        int lifeline = answer;
+        fb = session.use_lifeline(lifeline);
+
+        if (!fb.accepted) {
+            if (lifeline == LIFELINE_5050) cout << "\n[!] 50/50 already used!\n";
+            else if (lifeline == LIFELINE_SKIP) cout << "\n[!] Skip already used!\n";
+            else if (lifeline == LIFELINE_REPLACE) cout << "\n[!] Replace already used!\n";
+            else cout << "\nExtra Time already used!\n";
+        }
+        else if (lifeline == LIFELINE_5050) {
+            cout << "\n[LIFELINE USED: 50/50]\n";
+            cout << "Removing 2 wrong answers...\n\n";
+            cout << "\nOptions after 50/50:\n";
+            for (int i = 0; i < 4; i++) {
+                cout << i + 1 << ") " << session.option_text(i) << "\n";
+            }
+        }
+        else if (lifeline == LIFELINE_SKIP) {
+            cout << "\n[LIFELINE USED: Skip Question]\n";
+            cout << "Question skipped without penalty!\n";
+            cout << "\nPress Enter to Continue...";
+            cin.ignore();
+            cin.get();
+            return;
+        }
+        else if (lifeline == LIFELINE_REPLACE) {
+            cout << "\n[LIFELINE USED: Replace Question]\n";
+            cout << "Finding a new question...\n\n";
+            cout << "\n[Replace lifeline will load a new question in the next iteration]\n";
+            cout << "Press Enter to continue...";
+            cin.ignore();
+            cin.get();
+            return;
+        }
+        else {
+            cout << "\n[LIFELINE USED: Extra Time]\n";
+            cout << "+10 seconds added! New time: " << pq.time_limit << "s\n";
+        }
+
+        cout << "\nNow answer (1-4): ";
+        answered_in_time = get_answer_with_timer(session, answer, fb);
+
+        if (!answered_in_time) {
+            if (lifeline == LIFELINE_5050) cout << "Time's up after using 50/50!\n";
+            else if (lifeline == LIFELINE_EXTRATIME) cout << "Time's up even after extra time!\n";
+            timeout_shown = lifeline == LIFELINE_5050 || lifeline == LIFELINE_EXTRATIME;
+        }
+    }
+
+    if (answered_in_time) {
+        fb = session.answer(answer - 1);  // Convert to 0-based index
+    }
+    else if (fb.result == RESULT_TIMEOUT && !timeout_shown) {
+        cout << "You didn't answer in time! Correct answer: " << session.option_text(fb.correct_slot) << "\n";
+    }
+
+    if (fb.result == RESULT_CORRECT) {
+        cout << "\nCorrect!\n";
+        if (fb.bonus > 0) cout << "Streak Bonus +" << fb.bonus << " points!\n";
+    }
+    else if (fb.result == RESULT_WRONG) {
+        cout << "\nWrong! Correct answer: " << session.option_text(fb.correct_slot) << "\n";
+    }
+    if (fb.points < 0) {
+        cout << "Negative Mark: " << fb.points << " points\n";
+    }
+
+    cout << "\nCurrent Score: " << session.score << "\n";
+    cout << "Press Enter to continue...";
+    cin.ignore();
+    cin.get();
+}
+
+// ======================= LEADERBOARD ============================
+
+// ---------- Create an empty ranked list (head node only) ----------
+RankedList::RankedList() {
+    node_entry.push_back(-1);
+    node_links.push_back(0);
+    links.resize(skiplevels, Link{ -1, 1 });
+}
+
+// ---------- Insert an entry in ranked position ----------
+void RankedList::insert(int entry, const vector<ScoreEntry>& entries) {
+    const ScoreEntry& e = entries[entry];
+    auto before = [&](int node) {
+        const ScoreEntry& other = entries[node_entry[node]];
+        return other.score > e.score || (other.score == e.score && other.seq < e.seq);
+    };
+
+    // Find the last node before the new entry on every level, and its rank
+    int update[skiplevels];
+    int update_rank[skiplevels];
+    int node = 0, rank = 0;
+    for (int lvl = height - 1; lvl >= 0; lvl--) {
+        while (links[node_links[node] + lvl].next >= 0 && before(links[node_links[node] + lvl].next)) {
+            rank += links[node_links[node] + lvl].width;
+            node = links[node_links[node] + lvl].next;
+        }
+        update[lvl] = node;
+        update_rank[lvl] = rank;
+    }
+
+    // Random height with p = 1/2 per level
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 17;
+    random_state ^= random_state << 5;
+    int new_height = 1;
+    while (new_height < skiplevels && (random_state >> (new_height - 1) & 1)) new_height++;
+    for (int lvl = height; lvl < new_height; lvl++) {
+        update[lvl] = 0;
+        update_rank[lvl] = 0;
+        links[lvl].width = size + 1;  // Head to end of list
+    }
+    if (new_height > height) height = new_height;
+
+    // Splice the new node in, splitting the widths it lands between
+    int created = (int)node_entry.size();
+    node_entry.push_back(entry);
+    node_links.push_back((int)links.size());
+    links.resize(links.size() + new_height);
+    for (int lvl = 0; lvl < new_height; lvl++) {
+        Link& prev = links[node_links[update[lvl]] + lvl];
+        Link& link = links[node_links[created] + lvl];
+        link.next = prev.next;
+        link.width = prev.width - (rank - update_rank[lvl]);
+        prev.next = created;
+        prev.width = rank - update_rank[lvl] + 1;
+    }
+    for (int lvl = new_height; lvl < height; lvl++) {
+        links[node_links[update[lvl]] + lvl].width++;
+    }
+    size++;
+}
+
+// ---------- Rank of an entry ----------
+int RankedList::rank_of(int entry, const vector<ScoreEntry>& entries) const {
+    const ScoreEntry& e = entries[entry];
+    int node = 0, rank = 0;
+    for (int lvl = height - 1; lvl >= 0; lvl--) {
+        while (true) {
+            int next = links[node_links[node] + lvl].next;
+            if (next < 0) break;
+            const ScoreEntry& other = entries[node_entry[next]];
+            if (other.score < e.score || (other.score == e.score && other.seq > e.seq)) break;
+            rank += links[node_links[node] + lvl].width;
+            node = next;
+        }
+    }
+    return node_entry[node] == entry ? rank : 0;
+}
+
+// ---------- Node at a rank ----------
+int RankedList::node_at(int rank) const {
+    if (rank < 1 || rank > size) return -1;
+    int node = 0, pos = 0;
+    for (int lvl = height - 1; lvl >= 0; lvl--) {
+        while (links[node_links[node] + lvl].next >= 0 && pos + links[node_links[node] + lvl].width <= rank) {
+            pos += links[node_links[node] + lvl].width;
+            node = links[node_links[node] + lvl].next;
+        }
+    }
+    return node;
+}
+
+// ---------- Category / difficulty numbers from names ----------
+int category_from_name(string_view name) {
+    for (int cat = 1; cat <= 5; cat++)
+        if (name == category_name(cat)) return cat;
+    return 0;
+}
+
+int difficulty_from_name(string_view name) {
+    for (int level = 1; level <= 3; level++)
+        if (name == difficulty_name(level)) return level;
+    return 0;
+}
+
+// ---------- View index ----------
+int leaderboard_view(int cat, int level) {
+    return cat * 4 + level;
+}
+
+// ---------- Add one score to the index ----------
+void add_leaderboard_entry(string player, int score, string category, string difficulty) {
+    int id = (int)leaderboard.entries.size();
+    ScoreEntry entry;
+    entry.player = player;
+    entry.score = score;
+    entry.category = category;
+    entry.difficulty = difficulty;
+    entry.seq = (uint32_t)id;
+    leaderboard.entries.push_back(entry);
+
+    // The entry belongs to: all, its category, its difficulty, and both
+    int cat = category_from_name(category);
+    int level = difficulty_from_name(difficulty);
+    int views[4] = { leaderboard_view(0, 0), leaderboard_view(cat, 0), leaderboard_view(0, level),
+        leaderboard_view(cat, level) };
+    for (int i = 0; i < 4; i++) {
+        // Unknown category/difficulty names collapse views onto each other
+        bool duplicate = false;
+        for (int k = 0; k < i; k++)
+            if (views[k] == views[i]) duplicate = true;
+        if (duplicate) continue;
+
+        int view = views[i];
+        leaderboard.views[view].insert(id, leaderboard.entries);
+
+        // Remember each player's best entry (ties keep the earlier one)
+        auto found = leaderboard.best[view].find(player);
+        if (found == leaderboard.best[view].end() || leaderboard.entries[found->second].score < score) {
+            leaderboard.best[view][player] = id;
+        }
+    }
+}
+
+// ---------- Read high_scores.txt into the index once ----------
+void load_leaderboard(string name) {
+    if (leaderboard.loaded) return;
+    leaderboard.loaded = true;
+
+    // Scores still in the writer queue belong in the file we are about to read
+    writer_sync();
+
+    ifstream fin(name);
+    if (!fin.is_open()) return;
+
+    // Read all high score entries, skipping malformed lines
+    string line;
+    Record rec;
+    while (getline(fin, line)) {
+        int score;
+        if (!split_record(line, '|', rec, 4, 4)) continue;
+        if (!parse_field(rec.fields[1], -1000000, 1000000, score)) continue;
+        add_leaderboard_entry(string(rec.fields[0]), score, string(rec.fields[2]), string(rec.fields[3]));
+    }
+    fin.close();
+}
+
+// ======================= HIGH SCORES ============================
+
+// ---------- Save high score to file ----------
+void save_high_score(string player, int score, string category, string difficulty) {
+    TraceSpan span("save_high_score", "io");
+    // Queue under the leaderboard lock so load_leaderboard() sees each score
+    // either in the file or through add_leaderboard_entry(), never both
+    lock_guard<mutex> lock(leaderboard_mutex);
+
+    // Write in pipe-delimited format
+    writer_enqueue(WRITER_SCORES, player + "|" + to_string(score) + "|" + category + "|" + difficulty + "\n");
+
+    // Keep the ranked index in step with the file
+    if (leaderboard.loaded) add_leaderboard_entry(player, score, category, difficulty);
+}
+
+// ---------- Display high scores, one ranked page at a time ----------
+void show_high_scores() {
+    TraceSpan span("show_high_scores", "io");
+    lock_guard<mutex> lock(leaderboard_mutex);
+    load_leaderboard();
+    if (leaderboard.entries.empty()) {
+        screen_present("No high scores found!\nPress Enter...");
+        cin.get();
+        return;
+    }
+
+    int cat = 0, level = 0, page = 0;
+    string message;
+    while (true) {
+        const RankedList& list = leaderboard.views[leaderboard_view(cat, level)];
+        int pages = (list.size + leaderboardpage - 1) / leaderboardpage;
+        if (pages == 0) pages = 1;
+        if (page >= pages) page = pages - 1;
+
+        ostringstream frame;
+        frame << "========================================\n";
+        frame << "               HIGH SCORES\n";
+        frame << "========================================\n";
+        frame << "Category: " << (cat == 0 ? "All" : category_name(cat)) <<
+            "   Difficulty: " << (level == 0 ? "All" : difficulty_name(level)) <<
+            "   Page " << page + 1 << " of " << pages << "\n\n";
+        frame << "Rank\tPlayer\tScore\tCategory\tDifficulty\n";
+
+        // Jump straight to the page's first rank, then walk the bottom level
+        int node = list.node_at(page * leaderboardpage + 1);
+        for (int i = 0; i < leaderboardpage && node >= 0; i++) {
+            const ScoreEntry& e = leaderboard.entries[list.node_entry[node]];
+            frame << page * leaderboardpage + i + 1 << "\t" << e.player << "\t" << e.score << "\t" <<
+                e.category << "\t\t" << e.difficulty << "\n";
+            node = list.links[list.node_links[node]].next;
+        }
+
+        if (!message.empty()) frame << "\n" << message << "\n";
+        message.clear();
+        frame << "\nN) Next page  P) Previous page  F) Filter  R) Find player rank\n";
+        frame << "Press Enter to return...";
+        screen_present(frame.str());
+
+        string choice;
+        if (!getline(cin, choice) || choice.empty()) return;
+
+        char c = (char)toupper((unsigned char)choice[0]);
+        if (c == 'N') page++;
+        else if (c == 'P' && page > 0) page--;
+        else if (c == 'F') {
+            cout << "Category (0 = All, 1-5): ";
+            getline(cin, choice);
+            int value;
+            cat = parse_field(choice, 0, 5, value) ? value : 0;
+            cout << "Difficulty (0 = All, 1-3): ";
+            getline(cin, choice);
+            level = parse_field(choice, 0, 3, value) ? value : 0;
+            page = 0;
+        }
+        else if (c == 'R') {
+            cout << "Player name: ";
+            string name;
+            getline(cin, name);
+            auto found = leaderboard.best[leaderboard_view(cat, level)].find(name);
+            if (found == leaderboard.best[leaderboard_view(cat, level)].end()) {
+                message = name + " has no scores in this view.";
+            }
+            else {
+                int rank = list.rank_of(found->second, leaderboard.entries);
+                message = name + " is ranked #" + to_string(rank) + " of " + to_string(list.size) +
+                    " with " + to_string(leaderboard.entries[found->second].score) + " points.";
+                page = (rank - 1) / leaderboardpage;
+            }
+        }
+    }
+}
+
+// ======================= POST QUIZ MENU ============================
+
+// ---------- post quiz menu ----------
+void post_quiz_menu(const QuizSession& session) {
+    TraceSpan span("post_quiz_menu", "session");
+    while (true) {
+        ostringstream frame;
+        frame << "========================================\n";
+        frame << "           QUIZ COMPLETE!\n";
+        frame << "========================================\n";
+        frame << "Your Final Score: " << session.score << "/" << sessionquestions << "\n";
+        frame << "Correct Answers: " << session.correct_count << "\n";
+        frame << "Wrong Answers: " << session.wrong_count << "\n\n";
+
+        frame << "1. Review Incorrect Questions\n";
+        frame << "2. Replay Quiz (New Questions)\n";
+        frame << "3. Return to Main Menu\n";
+        frame << "Enter choice: ";
+        screen_present(frame.str());
+
+        int choice;
+        cin >> choice;
+        cin.ignore();
+
+        if (choice == 1) {
+            review_incorrect_questions(session);// To show incorrect questions
+        }
+        else if (choice == 2) {
+            // Replay quiz with new questions
+            start_quiz();
+            return;
+        }
+        else if (choice == 3) {
+            return;
+        }
+        else {
+            cout << "Invalid choice. Press Enter...";
+            cin.ignore();
+        }
+    }
+}
+
+// ======================= QUIZ LOGIC ============================
+
+// ---------- main quiz function ----------
+void start_quiz() {
+    TraceSpan span("start_quiz", "session");
+    // Held until the post-quiz menu returns, even if the bank is reloaded meanwhile
+    shared_ptr<const QuestionBank> bank = acquire_bank(category);
+    if (bank == nullptr) {
+        cout << "Failed to load questions.\nPress Enter...";
+        cin.ignore();
+        cin.get();
+        return;
+    }
+
+    // Prefer questions this player has not seen; the last session's may still be queued
+    writer_sync();
+    SeenBitmap seen;
+    load_seen_questions(playername, category, seen);
+
+    QuizSession session;
+    if (!session.start(*bank, difficulty, 15, &seen)) {
+        cout << "Not enough questions for this difficulty.\nPress Enter...";
+        cin.ignore();
+        cin.get();
+        return;
+    }
+    session.category = category;
+    uint64_t rating_key = rating_player_key(playername, category);
+    if (register_rating_player(ratings, category, rating_key)) session.rating_player = rating_key;
+
+    while (const PresentedQuestion* pq = session.present()) {
+        display_question(session, *pq);
+    }
+    SessionSummary summary = session.finish();
+
+    string category_str = category_name(category);
+    string difficulty_str = difficulty_name(difficulty);
+
+    save_quiz_log(playername, category_str, difficulty_str, summary.correct, summary.wrong, summary.score,
+        summary.outcomes);
+    save_high_score(playername, summary.score, category_str, difficulty_str);
+    record_seen_questions(playername, category, session.presented, session.presented_count);
+    save_session_trace(session, playername, category, summary);
+    post_quiz_menu(session);
+}
+
+// ======================= TIMER WHEEL ============================
+
+// ---------- Create an empty wheel ----------
+TimerWheel::TimerWheel() {
+    for (int i = 0; i < wheellevels * wheelsize; i++) heads[i] = -1;
+}
+
+// ---------- Allocate a timer handle ----------
+int TimerWheel::create(void* owner) {
+    int timer;
+    if (!free_nodes.empty()) {
+        timer = free_nodes.back();
+        free_nodes.pop_back();
+    }
+    else {
+        timer = (int)nodes.size();
+        nodes.push_back(TimerNode());
+    }
+    nodes[timer] = TimerNode();
+    nodes[timer].owner = owner;
+    return timer;
+}
+
+// ---------- Free a timer handle ----------
+void TimerWheel::destroy(int timer) {
+    cancel(timer);
+    nodes[timer].owner = nullptr;
+    free_nodes.push_back(timer);
+}
+
+// ---------- Arm a timer ----------
+void TimerWheel::schedule(int timer, uint64_t deadline) {
+    cancel(timer);
+    nodes[timer].deadline = deadline;
+    link(timer);
+}
+
+// ---------- Disarm a timer ----------
+void TimerWheel::cancel(int timer) {
+    TimerNode& node = nodes[timer];
+    if (node.slot < 0) return;
+    if (node.prev >= 0) nodes[node.prev].next = node.next;
+    else heads[node.slot] = node.next;
+    if (node.next >= 0) nodes[node.next].prev = node.prev;
+    node.next = node.prev = node.slot = -1;
+}
+
+// ---------- Link a timer into the slot for its deadline ----------
+void TimerWheel::link(int timer) {
+    TimerNode& node = nodes[timer];
+
+    // Already due: fire on the next processed tick
+    uint64_t deadline = node.deadline < base ? base : node.deadline;
+    uint64_t delta = deadline - base;
+
+    // Pick the lowest level whose span covers the delay
+    int level = 0;
+    while (level < wheellevels - 1 && delta >= (1ull << (wheelbits * (level + 1)))) level++;
+    if (delta >= (1ull << (wheelbits * wheellevels))) {
+        deadline = base + (1ull << (wheelbits * wheellevels)) - 1;  // Clamp; re-cascaded later
+    }
+    int index = (int)((deadline >> (wheelbits * level)) & (wheelsize - 1));
+
+    node.slot = level * wheelsize + index;
+    node.prev = -1;
+    node.next = heads[node.slot];
+    if (node.next >= 0) nodes[node.next].prev = timer;
+    heads[node.slot] = timer;
+}
+
+// ---------- Move one slot's timers down a level ----------
+int TimerWheel::cascade(int level, int index) {
+    int slot = level * wheelsize + index;
+    int timer = heads[slot];
+    heads[slot] = -1;
+    while (timer >= 0) {
+        int next = nodes[timer].next;
+        nodes[timer].slot = -1;
+        link(timer);
+        timer = next;
+    }
+    return index;
+}
+
+// ---------- Process ticks and collect expired timers ----------
+void TimerWheel::advance(uint64_t now, vector<void*>& expired) {
+    while (base <= now) {
+        int index = (int)(base & (wheelsize - 1));
+
+        // At each wrap of a level, pull the next slot of the level above down
+        for (int level = 1; index == 0 && level < wheellevels; level++) {
+            int upper = (int)((base >> (wheelbits * level)) & (wheelsize - 1));
+            if (cascade(level, upper) != 0) break;
+        }
+
+        // Everything left in this level-0 slot is due now
+        int timer = heads[index];
+        heads[index] = -1;
+        while (timer >= 0) {
+            TimerNode& node = nodes[timer];
+            int next = node.next;
+            node.next = node.prev = node.slot = -1;
+            if (node.deadline > base) {
+                link(timer);  // Clamped long timer, not due yet
+            }
+            else {
+                expired.push_back(node.owner);
+            }
+            timer = next;
+        }
+        base++;
+    }
+}
+
+// ---------- Current tick of the server's timer wheels ----------
+uint64_t current_tick() {
+    static const auto epoch = chrono::steady_clock::now();
+    auto elapsed = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - epoch).count();
+    return (uint64_t)elapsed * tickspersecond / 1000;
+}
+
+// ======================= BANK HOT RELOAD ============================
+
+// ---------- Publish a category's bank ----------
+void publish_bank(BankSlot& slot, shared_ptr<const QuestionBank> qb) {
+    shared_ptr<const QuestionBank>* fresh = qb ? new shared_ptr<const QuestionBank>(move(qb)) : nullptr;
+    shared_ptr<const QuestionBank>* old = slot.current.exchange(fresh);
+
+    // Anyone who could still be copying the old holder is counted in readers
+    while (slot.readers.load() != 0) this_thread::yield();
+    delete old;  // Sessions holding the bank keep it alive
+}
+
+// ---------- Current bank of a category ----------
+shared_ptr<const QuestionBank> acquire_bank(int cat) {
+    BankSlot& slot = bank_cache[cat];
+    slot.readers.fetch_add(1);
+    shared_ptr<const QuestionBank>* current = slot.current.load();
+    shared_ptr<const QuestionBank> snapshot = current != nullptr ? *current : nullptr;
+    slot.readers.fetch_sub(1);
+    return snapshot;
+}
+
+// ---------- Unmap a bank once its last holder lets go ----------
+void free_question_bank(const QuestionBank* qb) {
+    QuestionBank* owned = const_cast<QuestionBank*>(qb);
+    close_question_bank(*owned);
+    delete owned;
+}
+
+// ---------- Load every category's bank ----------
+int load_bank_cache() {
+    TraceSpan span("load_bank_cache", "bank");
+    // One shared, read-only copy of every bank for all sessions; the files are
+    // independent, so each is mapped (or compiled first) on its own thread
+    auto start = chrono::steady_clock::now();
+    shared_ptr<QuestionBank> loaded[6];
+    vector<thread> threads;
+    for (int cat = 1; cat <= 5; cat++) {
+        loaded[cat] = shared_ptr<QuestionBank>(new QuestionBank, free_question_bank);
+        threads.push_back(thread([&loaded, cat] {
+            trace_thread_name("bank loader");
+            load_bank(*loaded[cat], category_file(cat));
+            index_bank(*loaded[cat]);
+        }));
+    }
+    for (auto& t : threads) t.join();
+
+    int count = 0;
+    for (int cat = 1; cat <= 5; cat++) {
+        if (loaded[cat]->count == 0) continue;
+        publish_bank(bank_cache[cat], loaded[cat]);
+        count++;
+    }
+    bank_load_ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    return count;
+}
+
+// ---------- Describe the cache ----------
+string bank_cache_report() {
+    int banks = 0, questions = 0;
+    uint64_t bytes = 0;
+    string missing, malformed;
+    for (int cat = 1; cat <= 5; cat++) {
+        shared_ptr<const QuestionBank> qb = acquire_bank(cat);
+        if (qb == nullptr) {
+            missing += (missing.empty() ? "" : ", ") + category_file(cat);
+            continue;
+        }
+        banks++;
+        questions += qb->count;
+        if (qb->rejected > 0) {
+            malformed += (malformed.empty() ? "" : ", ") + category_file(cat) + " " + to_string(qb->rejected);
+        }
+        bytes += sizeof(QuestionBank) + qb->size;
+        for (int d = 0; d < 4; d++) bytes += qb->pool[d].capacity() * sizeof(int);
+        if (qb->index != nullptr) {
+            const TextIndex& index = *qb->index;
+            bytes += index.terms.capacity() + (index.term_offsets.capacity() + index.term_count.capacity() +
+                index.postings.capacity()) * sizeof(uint32_t) + (index.term_start.capacity() + index.bitmaps.capacity()) * sizeof(uint64_t);
+        }
+    }
+
+    char buffer[128];
+    sprintf_s(buffer, "%d of 5 banks, %d questions, %.1f KB, loaded in %.1f ms",
+        banks, questions, bytes / 1024.0, bank_load_ms);
+    string report = buffer;
+    if (!missing.empty()) report += " (missing: " + missing + ")";
+    if (!malformed.empty()) report += " (malformed lines skipped: " + malformed + "; --compile lists them)";
+    return report;
+}
+
+// ---------- Drop every published bank ----------
+void release_bank_cache() {
+    for (int cat = 1; cat <= 5; cat++) publish_bank(bank_cache[cat], nullptr);
+}
+
+// ---------- Reload one bank if its file changed ----------
+bool refresh_cached_bank(int cat, bool verbose) {
+    BankSlot& slot = bank_cache[cat];
+    shared_ptr<const QuestionBank> current = acquire_bank(cat);
+    string source = category_file(cat);
+    uint64_t size, time;
+    if (!get_file_stamp(source, size, time)) return false;
+
+    // A bank missing (or unusable) at startup has no snapshot yet; its file showing
+    // up counts as an edit, so the category becomes playable without a restart
+    if (current != nullptr) {
+        const BankHeader* header = (const BankHeader*)current->base;
+        if (header->source_size == size && header->source_time == time) return false;
+    }
+    if (slot.rejected_size == size && slot.rejected_time == time) return false;
+
+    // Editors save in several writes; wait until the file holds still (its last
+    // write signals the watcher again)
+    this_thread::sleep_for(chrono::milliseconds(banksettlems));
+    uint64_t settled_size, settled_time;
+    if (!get_file_stamp(source, settled_size, settled_time) || settled_size != size || settled_time != time) return false;
+
+    // Parsed and validated here, off the workers; they only ever see a finished bank.
+    // No session can hold a .qbk of a first snapshot, so that one is compiled to disk
+    shared_ptr<QuestionBank> fresh(new QuestionBank, free_question_bank);
+    bool usable = (current == nullptr ? load_bank(*fresh, source) : reload_bank(*fresh, source)) > 0;
+    for (int d = 1; d <= 3 && current != nullptr; d++) {
+        // An edit must not leave a level that could be played without enough questions
+        if ((int)current->pool[d].size() >= sessionquestions && (int)fresh->pool[d].size() < sessionquestions) usable = false;
+    }
+    if (!usable) {
+        slot.rejected_size = size;
+        slot.rejected_time = time;
+        if (verbose) cout << "Rejected edited " << source << " (unreadable or too few questions); keeping the previous bank\n";
+        return false;
+    }
+
+    index_bank(*fresh);  // Searches never see a bank without its index
+    int count = fresh->count, rejected = fresh->rejected;
+    publish_bank(slot, fresh);
+    rating_store_extend(ratings, cat, *fresh);  // Adaptive sessions can pick the new questions
+    if (verbose) {
+        cout << (current == nullptr ? "Loaded " : "Reloaded ") << source << " (" << count << " questions";
+        if (rejected > 0) cout << ", " << rejected << " malformed line(s) skipped";
+        cout << ")\n";
+    }
+    return true;
+}
+
+// ---------- Bank watcher thread ----------
+void watch_question_banks(bool verbose) {
+    trace_thread_name("bank watcher");
+    HANDLE change = FindFirstChangeNotificationA(".", FALSE,
+        FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_FILE_NAME);
+    if (change == INVALID_HANDLE_VALUE) {
+        if (verbose) cout << "Cannot watch the question banks; edits need a restart\n";
+        return;
+    }
+
+    while (bank_watching) {
+        // Wake now and then to notice the watch ending
+        if (WaitForSingleObject(change, 500) != WAIT_OBJECT_0) continue;
+        FindNextChangeNotification(change);
+
+        // Any file in the directory signals (the writer's logs too); checking
+        // five file stamps is cheap, so just look at every bank
+        for (int cat = 1; cat <= 5; cat++) refresh_cached_bank(cat, verbose);
+    }
+    FindCloseChangeNotification(change);
+}
+
+// ======================= QUIZ SERVER ============================
+
+// ---------- Stop the server on Ctrl+C ----------
+BOOL WINAPI server_ctrl_handler(DWORD event) {
+    if (event == CTRL_C_EVENT) {
+        server_running = false;
+        return TRUE;
+    }
+    return FALSE;
+}
+
+// ---------- Run the multi-session server ----------
+int run_server(int port, int workers) {
+    if (workers < 1) workers = 1;
+    if (load_bank_cache() < 5) {
+        cout << "Failed to load question banks: " << bank_cache_report() << "\n";
+        release_bank_cache();
+        return 1;
+    }
+    cout << "Question banks: " << bank_cache_report() << "\n";
+
+    WSADATA wsa;
+    if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) {
+        cout << "WSAStartup failed\n";
+        release_bank_cache();
+        return 1;
+    }
+
+    SOCKET listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons((u_short)port);
+    int reuse = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof(reuse));
+    if (listener == INVALID_SOCKET || ::bind(listener, (sockaddr*)&addr, sizeof(addr)) == SOCKET_ERROR ||
+        listen(listener, SOMAXCONN) == SOCKET_ERROR) {
+        cout << "Could not listen on port " << port << "\n";
+        WSACleanup();
+        release_bank_cache();
+        return 1;
+    }
+    u_long nonblocking = 1;
+    ioctlsocket(listener, FIONBIO, &nonblocking);
+
+    writer_start();
+    metrics_start();  // Also served on the game port: GET /metrics
+    seen_store_open(history, "seen_history");
+    open_question_tables();
+    history_loader_start();
+    server_running = true;
+    SetConsoleCtrlHandler(server_ctrl_handler, TRUE);
+    cout << "Quiz server listening on port " << port << " with " << workers << " workers (Ctrl+C to stop)\n";
+
+    vector<thread> threads;
+    for (int i = 0; i < workers; i++) threads.push_back(thread(server_worker, listener));
+    bank_watching = true;
+    thread watcher(watch_question_banks, true);  // Edited banks go live without a restart
+    for (auto& t : threads) t.join();
+    history_loader_stop();
+    bank_watching = false;
+    watcher.join();
+    writer_stop();  // Every finished session's score/log reaches disk
+    metrics_stop();
+    close_question_tables();
+
+    closesocket(listener);
+    WSACleanup();
+    release_bank_cache();
+    cout << "Server stopped.\n";
+    return 0;
+}
+
+// ---------- Server worker event loop ----------
+void server_worker(SOCKET listener) {
+    trace_thread_name("server worker");
+    // Heap-allocated so the wheel's owner pointers stay valid as the list changes
+    vector<unique_ptr<ClientConnection>> clients;
+    vector<WSAPOLLFD> fds;
+    vector<void*> expired;
+    TimerWheel wheel;
+    wheel.base = current_tick();
+    char buffer[4096];
+    int starting = 0;                // Clients waiting for a history load
+
+    while (server_running) {
+        // Listening socket first, then one entry per client
+        fds.resize(clients.size() + 1);
+        fds[0].fd = listener;
+        fds[0].events = POLLRDNORM;
+        fds[0].revents = 0;
+        for (size_t i = 0; i < clients.size(); i++) {
+            fds[i + 1].fd = clients[i]->sock;
+            fds[i + 1].events = POLLRDNORM | (clients[i]->outbuf.empty() ? 0 : POLLWRNORM);
+            fds[i + 1].revents = 0;
+        }
+
+        // Wake once per wheel tick at most to expire deadlines and notice shutdown
+        // (every millisecond while a START waits for its history)
+        WSAPoll(fds.data(), (ULONG)fds.size(), starting > 0 ? 1 : 1000 / tickspersecond);
+
+        // Accept new clients (other workers may win the race; that is fine)
+        if (fds[0].revents & POLLRDNORM) {
+            while (true) {
+                SOCKET sock = accept(listener, NULL, NULL);
+                if (sock == INVALID_SOCKET) break;
+                u_long nonblocking = 1;
+                ioctlsocket(sock, FIONBIO, &nonblocking);
+                int nodelay = 1;
+                setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, (const char*)&nodelay, sizeof(nodelay));
+                unique_ptr<ClientConnection> client(new ClientConnection());
+                client->sock = sock;
+                client->wheel = &wheel;
+                client->timer = wheel.create(client.get());
+                clients.push_back(move(client));
+            }
+        }
+
+        // Read whatever arrived and handle complete lines
+        for (size_t i = 0; i < fds.size() - 1; i++) {
+            ClientConnection& client = *clients[i];
+            if (!(fds[i + 1].revents & (POLLRDNORM | POLLHUP | POLLERR))) continue;
+
+            int n = recv(client.sock, buffer, sizeof(buffer), 0);
+            if (n <= 0) {
+                if (n == 0 || WSAGetLastError() != WSAEWOULDBLOCK) client.closing = true, client.outbuf.clear();
+                continue;
+            }
+            client.inbuf.append(buffer, n);
+            handle_client_lines(client);
+            if (client.inbuf.size() > 4096) client.closing = true;  // No line is this long
+        }
+
+        // Sessions whose history has been read start now, then their queued lines run
+        starting = 0;
+        for (auto& client : clients) {
+            if (client->starting == nullptr) continue;
+            if (!client->starting->done.load(memory_order_acquire)) {
+                starting++;
+                continue;
+            }
+            finish_client_start(*client);
+            handle_client_lines(*client);
+        }
+
+        // Expire question deadlines
+        expired.clear();
+        wheel.advance(current_tick(), expired);
+        for (void* owner : expired) {
+            ClientConnection& client = *(ClientConnection*)owner;
+            Feedback fb = client.session.tick(client.session.remaining);
+            if (fb.result == RESULT_TIMEOUT) {
+                send_feedback(client, fb);
+                send_next_question(client);
+            }
+        }
+
+        // Flush pending replies
+        for (auto& client : clients) {
+            if (client->outbuf.empty()) continue;
+            int n = send(client->sock, client->outbuf.data(), (int)client->outbuf.size(), 0);
+            if (n > 0) client->outbuf.erase(0, n);
+            else if (WSAGetLastError() != WSAEWOULDBLOCK) client->closing = true, client->outbuf.clear();
+        }
+
+        // Drop finished connections (swap-remove keeps this O(1) each)
+        for (size_t i = 0; i < clients.size(); ) {
+            if (clients[i]->closing && clients[i]->outbuf.empty()) {
+                wheel.destroy(clients[i]->timer);
+                closesocket(clients[i]->sock);
+                clients[i] = move(clients.back());
+                clients.pop_back();
+            }
+            else {
+                i++;
+            }
+        }
+    }
+
+    for (auto& client : clients) closesocket(client->sock);
+}
+
+// ---------- Handle a client's complete lines ----------
+void handle_client_lines(ClientConnection& client) {
+    size_t start = 0, pos;
+    while (client.starting == nullptr && (pos = client.inbuf.find('\n', start)) != string::npos) {
+        handle_client_line(client, string_view(client.inbuf).substr(start, pos - start));
+        start = pos + 1;
+    }
+    client.inbuf.erase(0, start);
+}
+
+// ---------- Start a session once its history is in ----------
+void finish_client_start(ClientConnection& client) {
+    shared_ptr<HistoryLoad> load = move(client.starting);
+    // The session keeps this snapshot even if the bank is reloaded meanwhile
+    client.bank = acquire_bank(load->category);
+    if (client.bank == nullptr || !client.session.start(*client.bank, load->level, 15, &load->seen)) {
+        client.bank.reset();
+        client.outbuf += "ERROR not enough questions\n";
+        return;
+    }
+    client.category = load->category;
+    client.session.category = load->category;
+    client.session.rating_player = load->rating_player;
+    client.playing = true;
+    send_next_question(client);
+}
+
+// ---------- Queue a history load ----------
+void queue_history_load(shared_ptr<HistoryLoad> load) {
+    {
+        lock_guard<mutex> lock(history_loader.lock);
+        history_loader.queue.push_back(move(load));
+    }
+    history_loader.wake.notify_one();
+}
+
+// ---------- History loader thread ----------
+void history_loader_loop() {
+    trace_thread_name("history loader");
+    vector<shared_ptr<HistoryLoad>> batch;
+    unique_lock<mutex> lock(history_loader.lock);
+    while (true) {
+        history_loader.wake.wait(lock, [] { return history_loader.stopping || !history_loader.queue.empty(); });
+        if (history_loader.queue.empty()) break;  // Stopping with nothing left
+        batch.swap(history_loader.queue);
+        lock.unlock();
+
+        // Loads of clients that disconnected meanwhile still finish; nobody reads them.
+        // New players get their rating slot here too, away from the workers' answers
+        for (auto& load : batch) {
+            load_seen_questions(load->player, load->category, load->seen);
+            uint64_t rating_key = rating_player_key(load->player, load->category);
+            if (register_rating_player(ratings, load->category, rating_key)) load->rating_player = rating_key;
+            load->done.store(true, memory_order_release);
+        }
+        batch.clear();
+        lock.lock();
+    }
+}
+
+// ---------- Start the history loader ----------
+void history_loader_start() {
+    history_loader.stopping = false;
+    history_loader.worker = thread(history_loader_loop);
+}
+
+// ---------- Stop the history loader ----------
+void history_loader_stop() {
+    if (!history_loader.worker.joinable()) return;
+    {
+        lock_guard<mutex> lock(history_loader.lock);
+        history_loader.stopping = true;
+    }
+    history_loader.wake.notify_one();
+    history_loader.worker.join();
+}
+
+// ---------- Handle one protocol line ----------
+void handle_client_line(ClientConnection& client, string_view line) {
+    TraceSpan span("handle_client_line", "server");
+    if (client.closing) return;  // Anything after QUIT or an HTTP request (its headers)
+    if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+    size_t space = line.find(' ');
+    string_view command = line.substr(0, space);
+    string_view args = space == string_view::npos ? string_view() : line.substr(space + 1);
+
+    if (command == "START") {
+        // START <category> <difficulty> <name>; the name is the rest of the line, spaces and all
+        int cat, level;
+        if (client.playing) {
+            client.outbuf += "ERROR session already running\n";
+            return;
+        }
+        size_t first = args.find(' ');
+        size_t second = first == string_view::npos ? string_view::npos : args.find(' ', first + 1);
+        if (second == string_view::npos || !parse_field(args.substr(0, first), 1, 5, cat) ||
+            !parse_field(args.substr(first + 1, second - first - 1), 1, adaptivelevel, level)) {
+            client.outbuf += "ERROR usage: START <category 1-5> <difficulty 1-4> <name>\n";
+            return;
+        }
+        client.player = string(args.substr(second + 1));
+
+        // The history may need disk reads, so the loader thread fetches it and the
+        // worker starts the session once it is in (finish_client_start)
+        client.starting = make_shared<HistoryLoad>();
+        client.starting->player = client.player;
+        client.starting->category = cat;
+        client.starting->level = level;
+        queue_history_load(client.starting);
+    }
+    else if (command == "ANSWER" && client.playing) {
+        int slot;
+        if (!parse_field(args, 1, 4, slot)) slot = 0;  // Invalid input counts as wrong
+        Feedback fb = client.session.answer(slot - 1);
+        client.wheel->cancel(client.timer);
+        send_feedback(client, fb);
+        send_next_question(client);
+    }
+    else if (command == "LIFELINE" && client.playing) {
+        int lifeline;
+        if (!parse_field(args, LIFELINE_5050, LIFELINE_EXTRATIME, lifeline)) {
+            client.outbuf += "ERROR usage: LIFELINE <5-8>\n";
+            return;
+        }
+        Feedback fb = client.session.use_lifeline(lifeline);
+        client.outbuf += "LIFELINE " + to_string(lifeline) + (fb.accepted ? " OK\n" : " USED\n");
+        if (!fb.accepted) return;
+
+        if (fb.result != RESULT_NONE) {
+            // Skip and Replace close the question
+            client.wheel->cancel(client.timer);
+            send_feedback(client, fb);
+        }
+        else {
+            // 50/50 and Extra Time restart the clock; move the deadline
+            client.wheel->schedule(client.timer, current_tick() + (uint64_t)client.session.remaining * tickspersecond);
+        }
+        send_next_question(client);
+    }
+    else if (command == "QUIT") {
+        client.closing = true;
+    }
+    else if (command == "GET") {
+        // A Prometheus scrape on the game port: GET /metrics HTTP/1.x, answered and closed
+        bool found = args.substr(0, args.find(' ')) == "/metrics";
+        string body = found ? metrics_text() : "Not found\n";
+        client.outbuf += string(found ? "HTTP/1.0 200 OK" : "HTTP/1.0 404 Not Found") +
+            "\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " + to_string(body.size()) +
+            "\r\nConnection: close\r\n\r\n" + body;
+        client.closing = true;
+    }
+    else if (!line.empty()) {
+        client.outbuf += "ERROR unknown command\n";
+    }
+}
+
+// ---------- Send the open question, or the final result ----------
+void send_next_question(ClientConnection& client) {
+    bool was_open = client.session.question_open;
+    const PresentedQuestion* pq = client.session.present();
+
+    if (pq == nullptr) {
+        SessionSummary summary = client.session.finish();
+        client.outbuf += "END " + to_string(summary.score) + " " + to_string(summary.correct) + " " +
+            to_string(summary.wrong) + "\n";
+        client.playing = false;
+
+        // Queued for the background writer; never waits on disk
+        save_quiz_log(client.player, category_name(client.category), difficulty_name(client.session.difficulty),
+            summary.correct, summary.wrong, summary.score, summary.outcomes);
+        record_seen_questions(client.player, client.category, client.session.presented,
+            client.session.presented_count);
+        save_high_score(client.player, summary.score, category_name(client.category),
+            difficulty_name(client.session.difficulty));
+        save_session_trace(client.session, client.player, client.category, summary);
+        client.bank.reset();  // A replaced bank is freed with its last session
+        return;
+    }
+
+    if (!was_open) {
+        client.wheel->schedule(client.timer, current_tick() + (uint64_t)client.session.remaining * tickspersecond);
+    }
+
+    client.outbuf += "QUESTION " + to_string(pq->number + 1) + " " + to_string(client.session.remaining) + "|";
+    client.outbuf.append(pq->view.text[0], pq->view.length[0]);
     for (int i = 0; i < 4; i++) {
-        shuffled_options[i] = options[i];
+        client.outbuf += '|';
+        string_view option = client.session.option_text(i);
+        client.outbuf.append(option.data(), option.size());
+    }
+    client.outbuf += '\n';
+}
+
+// ---------- Send the result of a closed question ----------
+void send_feedback(ClientConnection& client, const Feedback& fb) {
+    const char* names[] = { "NONE", "CORRECT", "WRONG", "TIMEOUT", "SKIPPED", "REPLACED" };
+    if (!fb.accepted) {
+        client.outbuf += "ERROR no open question\n";
+        return;
+    }
+    client.outbuf += string("RESULT ") + names[fb.result] + " " + to_string(fb.points) + " " +
+        to_string(client.session.score) + " " + to_string(fb.correct_slot + 1) + "\n";
+}
+
+// ======================= SERVER LOAD CLIENT ============================
+
+// ---------- Read one line from a blocking socket ----------
+bool read_socket_line(SOCKET sock, string& pending, string& line) {
+    char buffer[4096];
+    while (true) {
+        size_t pos = pending.find('\n');
+        if (pos != string::npos) {
+            line = pending.substr(0, pos);
+            pending.erase(0, pos + 1);
+            return true;
+        }
+        int n = recv(sock, buffer, sizeof(buffer), 0);
+        if (n <= 0) return false;
+        pending.append(buffer, n);
     }
+}
 
-    if (!is_review) {
-        // Shuffle options randomly
-        for (int i = 3; i > 0; i--) {
-            int j = rand() % (i + 1);
-            swap(shuffled_options[i], shuffled_options[j]);
-            swap(map[i], map[j]);
-        }
+// ---------- Play bot sessions against a server ----------
+int run_server_load(int port, int clients, int sessions) {
+    if (clients < 1) clients = 1;
+    if (sessions < clients) sessions = clients;
+
+    WSADATA wsa;
+    if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) return 1;
+
+    atomic<int> sessions_left(sessions);
+    atomic<int> sessions_done(0);
+    atomic<int> failures(0);
+    vector<vector<double>> latencies(clients);  // Answer-to-feedback, microseconds
+
+    auto start = chrono::steady_clock::now();
+    vector<thread> threads;
+    for (int c = 0; c < clients; c++) {
+        threads.push_back(thread([&, c]() {
+            SOCKET sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+            sockaddr_in addr;
+            memset(&addr, 0, sizeof(addr));
+            addr.sin_family = AF_INET;
+            addr.sin_port = htons((u_short)port);
+            inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+            if (connect(sock, (sockaddr*)&addr, sizeof(addr)) == SOCKET_ERROR) {
+                failures++;
+                closesocket(sock);
+                return;
+            }
+            int nodelay = 1;
+            setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, (const char*)&nodelay, sizeof(nodelay));
+
+            string pending, line;
+            unsigned seed = (unsigned)c * 2654435761u + 1;
+            while (sessions_left-- > 0) {
+                seed = seed * 1103515245u + 12345u;
+                string start_cmd = "START " + to_string(seed % 5 + 1) + " " + to_string((seed >> 8) % 3 + 1) +
+                    " bot" + to_string(c) + "\n";
+                send(sock, start_cmd.data(), (int)start_cmd.size(), 0);
+
+                bool ok = true;
+                while ((ok = read_socket_line(sock, pending, line))) {
+                    if (line.compare(0, 3, "END") == 0) break;
+                    if (line.compare(0, 8, "QUESTION") != 0) continue;
+
+                    // Answer at random and time the round trip to the RESULT line
+                    seed = seed * 1103515245u + 12345u;
+                    string answer = "ANSWER " + to_string((seed >> 16) % 4 + 1) + "\n";
+                    auto sent = chrono::steady_clock::now();
+                    send(sock, answer.data(), (int)answer.size(), 0);
+                    while ((ok = read_socket_line(sock, pending, line)) && line.compare(0, 6, "RESULT") != 0) {}
+                    if (!ok) break;
+                    latencies[c].push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - sent).count());
+                }
+                if (!ok) {
+                    failures++;
+                    break;
+                }
+                sessions_done++;
+            }
+            send(sock, "QUIT\n", 5, 0);
+            closesocket(sock);
+        }));
     }
-    else {
-        // In review mode, don't shuffle
-        for (int i = 0; i < 4; i++) {
-            map[i] = i;
+    for (auto& t : threads) t.join();
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    WSACleanup();
+
+    vector<double> all;
+    for (auto& v : latencies) all.insert(all.end(), v.begin(), v.end());
+    sort(all.begin(), all.end());
+    auto percentile = [&](double p) { return all.empty() ? 0.0 : all[(size_t)(p * (all.size() - 1))]; };
+
+    cout << "Sessions completed: " << sessions_done << " (" << failures << " failed) in " << seconds << " s\n";
+    cout << "Throughput:         " << (seconds > 0 ? sessions_done / seconds : 0) << " sessions/s\n";
+    cout << "Answer latency:     p50 " << percentile(0.50) << " us, p99 " << percentile(0.99) <<
+        " us, max " << percentile(1.0) << " us\n";
+    return failures == 0 ? 0 : 1;
+}
+
+// ======================= LOAD DRIVER ============================
+
+// ---------- Counted heap allocation ----------
+// Every form of operator new and delete is replaced so the load driver can count
+// allocations; only threads that set allocation_counter (bot players) count, and
+// every block comes from the process heap either way
+void* counted_allocate(size_t size, size_t alignment) {
+    if (allocation_counter != nullptr) (*allocation_counter)++;
+    if (size == 0) size = 1;
+    if (alignment <= __STDCPP_DEFAULT_NEW_ALIGNMENT__) return HeapAlloc(GetProcessHeap(), 0, size);
+
+    // Over-aligned: the heap block's address is kept just below the aligned one
+    char* raw = (char*)HeapAlloc(GetProcessHeap(), 0, size + alignment + sizeof(void*));
+    if (raw == nullptr) return nullptr;
+    uintptr_t aligned = ((uintptr_t)raw + sizeof(void*) + alignment - 1) & ~(uintptr_t)(alignment - 1);
+    ((void**)aligned)[-1] = raw;
+    return (void*)aligned;
+}
+
+// ---------- Counted heap release ----------
+void counted_free(void* p, size_t alignment) {
+    if (p == nullptr) return;
+    if (alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__) p = ((void**)p)[-1];
+    HeapFree(GetProcessHeap(), 0, p);
+}
+
+void* operator new(size_t size) {
+    if (void* p = counted_allocate(size, 0)) return p;
+    throw bad_alloc();
+}
+void* operator new[](size_t size) {
+    if (void* p = counted_allocate(size, 0)) return p;
+    throw bad_alloc();
+}
+void* operator new(size_t size, align_val_t alignment) {
+    if (void* p = counted_allocate(size, (size_t)alignment)) return p;
+    throw bad_alloc();
+}
+void* operator new[](size_t size, align_val_t alignment) {
+    if (void* p = counted_allocate(size, (size_t)alignment)) return p;
+    throw bad_alloc();
+}
+void* operator new(size_t size, const nothrow_t&) noexcept { return counted_allocate(size, 0); }
+void* operator new[](size_t size, const nothrow_t&) noexcept { return counted_allocate(size, 0); }
+void* operator new(size_t size, align_val_t alignment, const nothrow_t&) noexcept {
+    return counted_allocate(size, (size_t)alignment);
+}
+void* operator new[](size_t size, align_val_t alignment, const nothrow_t&) noexcept {
+    return counted_allocate(size, (size_t)alignment);
+}
+
+void operator delete(void* p) noexcept { counted_free(p, 0); }
+void operator delete[](void* p) noexcept { counted_free(p, 0); }
+void operator delete(void* p, size_t) noexcept { counted_free(p, 0); }
+void operator delete[](void* p, size_t) noexcept { counted_free(p, 0); }
+void operator delete(void* p, const nothrow_t&) noexcept { counted_free(p, 0); }
+void operator delete[](void* p, const nothrow_t&) noexcept { counted_free(p, 0); }
+void operator delete(void* p, align_val_t alignment) noexcept { counted_free(p, (size_t)alignment); }
+void operator delete[](void* p, align_val_t alignment) noexcept { counted_free(p, (size_t)alignment); }
+void operator delete(void* p, size_t, align_val_t alignment) noexcept { counted_free(p, (size_t)alignment); }
+void operator delete[](void* p, size_t, align_val_t alignment) noexcept { counted_free(p, (size_t)alignment); }
+void operator delete(void* p, align_val_t alignment, const nothrow_t&) noexcept { counted_free(p, (size_t)alignment); }
+void operator delete[](void* p, align_val_t alignment, const nothrow_t&) noexcept {
+    counted_free(p, (size_t)alignment);
+}
+
+// ---------- Think-time option ----------
+bool parse_think_time(string_view spec, BotProfile& profile) {
+    size_t colon = spec.find(':');
+    string_view kind = spec.substr(0, colon);
+    string value(colon == string_view::npos ? string_view() : spec.substr(colon + 1));
+
+    if (kind == "none") {
+        profile.think = THINK_NONE;
+        return true;
+    }
+    if (kind == "fixed" || kind == "exp") {
+        profile.think = kind == "fixed" ? THINK_FIXED : THINK_EXPONENTIAL;
+        profile.think_a = atof(value.c_str());
+        return profile.think_a >= 0;
+    }
+    if (kind == "uniform") {
+        size_t dash = value.find('-');
+        if (dash == string::npos) return false;
+        profile.think = THINK_UNIFORM;
+        profile.think_a = atof(value.substr(0, dash).c_str());
+        profile.think_b = atof(value.substr(dash + 1).c_str());
+        return profile.think_a >= 0 && profile.think_b >= profile.think_a;
+    }
+    return false;
+}
+
+// ---------- Draw a think time ----------
+double draw_think_ms(const BotProfile& profile, mt19937& rng) {
+    switch (profile.think) {
+    case THINK_FIXED:
+        return profile.think_a;
+    case THINK_UNIFORM:
+        return uniform_real_distribution<double>(profile.think_a, profile.think_b)(rng);
+    case THINK_EXPONENTIAL:
+        return profile.think_a > 0 ? exponential_distribution<double>(1.0 / profile.think_a)(rng) : 0;
+    }
+    return 0;
+}
+
+// ---------- One simulated player ----------
+void bot_player(int id, int sessions, const BotProfile& profile, BotStats& stats) {
+    trace_thread_name("bot");
+    mt19937 rng(9781u + id);
+    uniform_real_distribution<double> chance(0.0, 1.0);
+
+    // Sized up front so recording a sample never allocates mid-session
+    stats.action_us.reserve((size_t)sessions * (sessionquestions * 3 + 4));
+    stats.session_us.reserve(sessions);
+    stats.allocations.reserve(sessions);
+
+    // This thread's operator new calls are counted from here on
+    uint64_t allocations = 0;
+    allocation_counter = &allocations;
+
+    QuizSession session;
+    for (int n = 0; n < sessions; n++) {
+        int cat = (int)(rng() % 5) + 1, level = (int)(rng() % 3) + 1;
+        double engine_us = 0;
+        uint64_t allocations_before = allocations;
+
+        auto t0 = chrono::steady_clock::now();
+        shared_ptr<const QuestionBank> snapshot = acquire_bank(cat);
+        // Seeded per bot and session, so a run can be repeated exactly
+        bool started = snapshot != nullptr && session.start(*snapshot, level, 15, nullptr, ((uint64_t)id + 1) << 32 | (uint64_t)(n + 1));
+        engine_us += chrono::duration<double, micro>(chrono::steady_clock::now() - t0).count();
+        if (!started) continue;
+        session.category = cat;
+        uint64_t allocations_started = allocations;
+
+        while (true) {
+            t0 = chrono::steady_clock::now();
+            const PresentedQuestion* pq = session.present();
+            engine_us += chrono::duration<double, micro>(chrono::steady_clock::now() - t0).count();
+            if (pq == nullptr) break;
+
+            // Think while the question clock runs; whole seconds count against it
+            double think = draw_think_ms(profile, rng);
+            if (think > 0) {
+                this_thread::sleep_for(chrono::microseconds((int64_t)(think * 1000)));
+                int seconds = (int)(think / 1000);
+                if (seconds > 0) {
+                    t0 = chrono::steady_clock::now();
+                    Feedback fb = session.tick(seconds);
+                    double us = chrono::duration<double, micro>(chrono::steady_clock::now() - t0).count();
+                    stats.action_us.push_back((float)us);
+                    engine_us += us;
+                    if (fb.result == RESULT_TIMEOUT) {
+                        stats.timeouts++;
+                        continue;
+                    }
+                }
+            }
+
+            if (chance(rng) < profile.lifeline_rate) {
+                int lifeline = LIFELINE_5050 + (int)(rng() % 4);
+                t0 = chrono::steady_clock::now();
+                Feedback fb = session.use_lifeline(lifeline);
+                double us = chrono::duration<double, micro>(chrono::steady_clock::now() - t0).count();
+                stats.action_us.push_back((float)us);
+                engine_us += us;
+                if (fb.accepted) stats.lifelines++;
+                if (fb.result == RESULT_SKIPPED || fb.result == RESULT_REPLACED) continue;
+            }
+
+            // Right answer with the profile's accuracy, otherwise a remaining wrong option
+            int slot = pq->correct_slot;
+            if (chance(rng) >= profile.accuracy) {
+                do {
+                    slot = (int)(rng() % 4);
+                } while (slot == pq->correct_slot || pq->removed[slot]);
+            }
+            t0 = chrono::steady_clock::now();
+            Feedback fb = session.answer(slot);
+            double us = chrono::duration<double, micro>(chrono::steady_clock::now() - t0).count();
+            stats.action_us.push_back((float)us);
+            engine_us += us;
+            if (fb.result == RESULT_CORRECT) stats.correct++;
+            else stats.wrong++;
         }
+
+        stats.question_allocations += (int64_t)(allocations - allocations_started);
+        t0 = chrono::steady_clock::now();
+        session.finish();
+        engine_us += chrono::duration<double, micro>(chrono::steady_clock::now() - t0).count();
+
+        stats.session_us.push_back((float)engine_us);
+        stats.allocations.push_back((uint32_t)(allocations - allocations_before));
+        stats.sessions++;
     }
+    allocation_counter = nullptr;
+}
 
-    // Find new position of correct answer after shuffle
-    int new_correct = 0;
-    for (int i = 0; i < 4; i++)
-        if (map[i] == correct_pos)
-            new_correct = i;
+// ---------- Load driver ----------
+int run_load_driver(int players, int sessions, const BotProfile& profile) {
+    if (players < 1) players = 1;
+    if (sessions < 1) sessions = 1;
+    // Shared banks, as in server mode
+    if (load_bank_cache() < 5) {
+        cout << "Failed to load question banks: " << bank_cache_report() << "\n";
+        release_bank_cache();
+        return 1;
+    }
 
-    // Display question and options
-    cout << question << "\n\n";
-    for (int i = 0; i < 4; i++)
-        cout << i + 1 << ") " << shuffled_options[i] << "\n";
+    vector<BotStats> stats(players);
+    vector<thread> threads;
+    metrics_start();
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < players; i++) {
+        threads.push_back(thread(bot_player, i, sessions, cref(profile), ref(stats[i])));
+    }
+    for (auto& t : threads) t.join();
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    vector<float> actions, session_us;
+    vector<uint32_t> allocations;
+    int64_t total = 0, correct = 0, wrong = 0, timeouts = 0, lifelines = 0, question_allocations = 0;
+    for (const BotStats& s : stats) {
+        question_allocations += s.question_allocations;
+        actions.insert(actions.end(), s.action_us.begin(), s.action_us.end());
+        session_us.insert(session_us.end(), s.session_us.begin(), s.session_us.end());
+        allocations.insert(allocations.end(), s.allocations.begin(), s.allocations.end());
+        total += s.sessions;
+        correct += s.correct;
+        wrong += s.wrong;
+        timeouts += s.timeouts;
+        lifelines += s.lifelines;
+    }
+    sort(actions.begin(), actions.end());
+    sort(session_us.begin(), session_us.end());
+    sort(allocations.begin(), allocations.end());
+    auto percentile = [](const auto& all, double p) { return all.empty() ? 0.0 : (double)all[(size_t)(p * (all.size() - 1))]; };
+    double allocation_sum = 0;
+    for (uint32_t a : allocations) allocation_sum += a;
+
+    cout << "Players:            " << players << " x " << sessions << " sessions (accuracy " << profile.accuracy <<
+        ", lifeline rate " << profile.lifeline_rate << ")\n";
+    cout << "Sessions completed: " << total << " in " << seconds << " s\n";
+    cout << "Throughput:         " << (seconds > 0 ? total / seconds : 0) << " sessions/s\n";
+    cout << "Action latency:     p50 " << percentile(actions, 0.50) << " us, p99 " << percentile(actions, 0.99) <<
+        " us, max " << percentile(actions, 1.0) << " us\n";
+    cout << "Engine time:        p50 " << percentile(session_us, 0.50) << " us, p99 " << percentile(session_us, 0.99) <<
+        " us per session (think time excluded)\n";
+    cout << "Allocations:        " << (total > 0 ? allocation_sum / total : 0) << " per session (p99 " <<
+        percentile(allocations, 0.99) << ", max " << percentile(allocations, 1.0) << "), " << question_allocations <<
+        " in all between start and finish\n";
+    cout << "Answers:            " << correct << " correct, " << wrong << " wrong, " << timeouts << " timed out, " <<
+        lifelines << " lifelines used\n";
+    metrics_stop();
+    if (!metrics.path.empty()) cout << "Metrics:            " << metrics.path << "\n";
+
+    release_bank_cache();
+    if (question_allocations > 0) {
+        cout << "FAILED: the question path allocated; --check-allocations finds the session\n";
+        return 1;
+    }
+    return 0;
+}
 
-    // If in review mode, just show answer and return
-    if (is_review) {
-        cout << "\n** Correct Answer: " << shuffled_options[new_correct] << " **\n";
-        cout << "\nPress Enter to continue...";
-        cin.get();
-        return;
+// ---------- Check the question path never allocates ----------
+int run_allocation_check(int sessions) {
+    if (sessions < 1) sessions = 1;
+    if (load_bank_cache() < 5) {
+        cout << "Failed to load question banks: " << bank_cache_report() << "\n";
+        release_bank_cache();
+        return 1;
     }
 
-    // Show available lifelines
-    cout << "\n--- Lifelines Available ---\n";
-    cout << "5) 50/50" << (lifeline_5050 ? " [AVAILABLE]" : " [USED]") << "\n";
-    cout << "6) Skip Question" << (lifeline_skip ? " [AVAILABLE]" : " [USED]") << "\n";
-    cout << "7) Replace Question" << (lifeline_replace ? " [AVAILABLE]" : " [USED]") << "\n";
-    cout << "8) Extra Time" << (lifeline_extratime ? " [AVAILABLE]" : " [USED]") << "\n";
+    mt19937 rng(4099u);
+    QuizSession reused;
+    int64_t played = 0, failed = 0;
+    for (int cat = 1; cat <= 5; cat++) {
+        shared_ptr<const QuestionBank> snapshot = acquire_bank(cat);
+        for (int level = 1; level <= 3; level++) {
+            for (int n = 0; n < sessions; n++) {
+                // Half the sessions reuse a warm arena, half start from an empty one as the
+                // console does; every other one has a history of about half the bank seen
+                QuizSession fresh;
+                QuizSession& session = n % 4 < 2 ? reused : fresh;
+                SeenBitmap seen;
+                if (n % 2 == 1) {
+                    for (int id = 0; id < snapshot->count; id++) {
+                        if (rng() % 2 == 0) seen.add((uint32_t)id);
+                    }
+                }
+                if (!session.start(*snapshot, level, 15, n % 2 == 1 ? &seen : nullptr, (uint64_t)(cat * 4 + level) << 32 | (uint64_t)(n + 1))) {
+                    cout << "Category " << cat << " difficulty " << level << ": too few questions\n";
+                    release_bank_cache();
+                    return 1;
+                }
+                session.category = cat;
+
+                // Counted from the first question through the summary
+                uint64_t allocations = 0;
+                allocation_counter = &allocations;
+                while (const PresentedQuestion* pq = session.present()) {
+                    // Each lifeline comes up on some question (and is tried again once used)
+                    int action = (int)(rng() % 8);
+                    if (action < 4) {
+                        Feedback fb = session.use_lifeline(LIFELINE_5050 + action);
+                        if (fb.result == RESULT_SKIPPED || fb.result == RESULT_REPLACED) continue;
+                    }
+
+                    // The clock runs a second at a time, as on the console; some questions time out
+                    int wait = action == 4 || action == 5 ? session.remaining : (int)(rng() % session.remaining);
+                    for (int second = 0; second < wait && session.question_open; second++) session.tick(1);
+                    if (!session.question_open) continue;
+                    session.answer(rng() % 2 == 0 ? pq->correct_slot : (pq->correct_slot + 1) % 4);
+                }
+                session.finish();
+                allocation_counter = nullptr;
+
+                played++;
+                if (allocations > 0) {
+                    failed++;
+                    if (failed <= 10) {
+                        cout << "Category " << cat << " difficulty " << level << " session " << n + 1 << ": " <<
+                            allocations << " allocation(s) between start and finish\n";
+                    }
+                }
+            }
+        }
+    }
 
-    int answer;
-    cout << "\nYour answer (1-4) or lifeline (5-8): ";
+    release_bank_cache();
+    cout << played << " sessions played, " << failed << " allocated between start and finish\n";
+    if (failed > 0) {
+        cout << "FAILED\n";
+        return 1;
+    }
+    cout << "OK\n";
+    return 0;
+}
 
-    bool answered_in_time = get_answer_with_timer(answer, current_timer);
+// ======================= BENCHMARK SUITE ============================
 
-    // Handle lifeline choices
-    if (answered_in_time) {
-        if (answer == 5) {
-            // Use 50/50 lifeline
-            use_lifeline_5050(shuffled_options, new_correct);
+// ---------- Synthetic question bank ----------
+void write_bench_bank(string name, int64_t rows) {
+    ofstream fout(name);
+    string line;
+    for (int64_t i = 0; i < rows; i++) {
+        line = "Which of these is question number " + to_string(i) + "?|Keyboard " + to_string(i % 97) +
+            "|Monitor|CPU|Printer|" + to_string(i % 4 + 1) + "|" + to_string(i % 3 + 1) + "\n";
+        fout << line;
+    }
+}
 
-            cout << "\nOptions after 50/50:\n";
-            for (int i = 0; i < 4; i++) {
-                cout << i + 1 << ") " << shuffled_options[i] << "\n";
-            }
+// ---------- Synthetic high score file ----------
+void write_bench_scores(string name, int64_t rows) {
+    ofstream fout(name);
+    string line;
+    uint32_t state = 2463534242u;
+    for (int64_t i = 0; i < rows; i++) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        line = "player" + to_string(state % (rows / 4 + 1)) + "|" + to_string((int)(state % 61) - 30) + "|" +
+            category_name(state % 5 + 1) + "|" + difficulty_name(state / 5 % 3 + 1) + "\n";
+        fout << line;
+    }
+}
+
+// ---------- Best of several runs ----------
+double time_best(int reps, const function<void()>& body) {
+    double best = 1e300;
+    for (int r = 0; r < reps; r++) {
+        auto t0 = chrono::steady_clock::now();
+        body();
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+        if (seconds < best) best = seconds;
+    }
+    return best;
+}
 
-            cout << "\nNow answer (1-4): ";
-            answered_in_time = get_answer_with_timer(answer, current_timer);
+// ---------- Record one result ----------
+void add_bench_result(vector<BenchResult>& results, string name, int64_t rows, int64_t items, double seconds) {
+    BenchResult result;
+    result.name = name;
+    result.rows = rows;
+    result.items = items;
+    result.seconds = seconds;
+    results.push_back(result);
+
+    char line[160];
+    sprintf_s(line, "%-26s %10lld rows %12.3f ms %12.1f ns/item", name.c_str(), (long long)rows,
+        seconds * 1000, items > 0 ? seconds * 1e9 / items : 0.0);
+    cout << line << "\n";
+}
 
-            if (!answered_in_time) {
-                // Timed out after using 50/50
-                cout << "Time's up after using 50/50!\n";
-                int negativemark = 0;
-                if (difficulty == 1) negativemark = 2;
-                else if (difficulty == 2) negativemark = 3;
-                else if (difficulty == 3) negativemark = 5;
+// ---------- Results as JSON ----------
+bool write_bench_json(string name, const vector<BenchResult>& results, long long checksum) {
+    ofstream fout(name);
+    if (!fout.is_open()) {
+        cout << "Error opening " << name << "\n";
+        return false;
+    }
 
-                score -= negativemark;
-                cout << "Negative Mark: -" << negativemark << " points\n";
-                streak = 0;
-                wrong_count++;
+    char number[64];
+    fout << "{\n  \"suite\": \"quiz-hot-paths\",\n  \"date\": \"" << get_current_datetime() << "\",\n";
+    fout << "  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult& r = results[i];
+        fout << "    {\"name\": \"" << r.name << "\", \"rows\": " << r.rows << ", \"items\": " << r.items;
+        sprintf_s(number, "%.9f", r.seconds);
+        fout << ", \"seconds\": " << number;
+        sprintf_s(number, "%.3f", r.items > 0 ? r.seconds * 1e9 / r.items : 0.0);
+        fout << ", \"ns_per_item\": " << number << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    fout << "  ],\n  \"checksum\": " << checksum << "\n}\n";  // Written out, so the timed work is never optimized away
+    return true;
+}
 
-                // Store for review
-                incorrect_questions[incorrect_count] = question;
-                for (int i = 0; i < 4; i++) {
-                    incorrect_options[incorrect_count][i] = shuffled_options[i];
+// ---------- Hot-path benchmark suite ----------
+int run_bench_suite(string json_name, int64_t max_rows) {
+    if (max_rows < 1000) max_rows = 1000;
+    vector<BenchResult> results;
+    long long checksum = 0;
+    Pcg32 rng;
+    rng.seed(12345);  // Same synthetic shuffles on every run
+
+    // Synthetic files live next to the real ones under bench_ names
+    const string bank_txt = "bench_bank.txt", bank_qbk = "bench_bank.qbk";
+    const string scores_txt = "bench_scores.txt";
+    const string out_scores = "bench_scores_out.txt", out_logs = "bench_logs.qcl";
+
+    for (int64_t rows = 1000; rows <= max_rows; rows *= 10) {
+        int reps = rows <= 100000 ? 5 : rows <= 1000000 ? 3 : 1;
+        cout << "--- " << rows << " rows ---\n";
+
+        // load_bank(): compile the text bank, then map the compiled one
+        write_bench_bank(bank_txt, rows);
+        QuestionBank qb;
+        double compile = time_best(reps, [&] {
+            remove(bank_qbk.c_str());
+            load_bank(qb, bank_txt);
+        });
+        add_bench_result(results, "load_questions_compile", rows, rows, compile);
+        double mapped = time_best(reps, [&] { load_bank(qb, bank_txt); });
+        add_bench_result(results, "load_questions_mapped", rows, rows, mapped);
+
+        // cut() and split_record() on the same lines
+        vector<string> lines((size_t)rows);
+        {
+            ifstream fin(bank_txt);
+            for (auto& line : lines) getline(fin, line);
+        }
+        double cut_time = time_best(reps, [&] {
+            for (const string& original : lines) {
+                string line = original;
+                for (int f = 0; f < 7; f++) checksum += cut(line).size();
+            }
+        });
+        add_bench_result(results, "tokenize_cut", rows, rows, cut_time);
+        double split_time = time_best(reps, [&] {
+            Record rec;
+            int correct, level;
+            for (const string& line : lines)
+                if (parse_question_record(line, rec, correct, level)) checksum += rec.fields[0].size() + correct;
+        });
+        add_bench_result(results, "tokenize_split_record", rows, rows, split_time);
+        lines.clear();
+        lines.shrink_to_fit();
+
+        // shuffle_array() over the whole bank
+        vector<int> ids((size_t)rows);
+        for (int64_t i = 0; i < rows; i++) ids[i] = (int)i;
+        double shuffle_time = time_best(reps, [&] { shuffle_array(ids.data(), (int)rows, rng); });
+        add_bench_result(results, "shuffle_array", rows, rows, shuffle_time);
+        ids.clear();
+        ids.shrink_to_fit();
+
+        // Sessions on this bank: option shuffle, answers and scoring (what display_question drives)
+        int64_t sessions = max<int64_t>(3, min<int64_t>(20000, 50000000 / rows));
+        double play_time = time_best(reps, [&] {
+            QuizSession session;
+            for (int64_t n = 0; n < sessions; n++) {
+                session.start(qb, (int)(n % 3) + 1, 15, nullptr, (uint64_t)n + 1);
+                int turn = 0;
+                while (const PresentedQuestion* pq = session.present()) {
+                    if (turn++ == 2) session.use_lifeline(LIFELINE_5050);
+                    session.answer(turn % 3 == 0 ? pq->correct_slot : (pq->correct_slot + 1) % 4);
                 }
-                incorrect_correct_pos[incorrect_count] = new_correct;
-                incorrect_count++;
+                checksum += session.finish().score;
+            }
+        });
+        add_bench_result(results, "session_play", rows, sessions, play_time);
 
-                cout << "\nCurrent Score: " << score << "\n";
-                cout << "Press Enter to continue...";
-                cin.ignore();
-                cin.get();
-                return;
+        // One answer-metrics record per row (latencies spread over the histogram)
+        double record_time = time_best(reps, [&] {
+            for (int64_t i = 0; i < rows; i++) {
+                record_question_metrics((int)(i % 5) + 1, RESULT_CORRECT, (uint64_t)(i * 2654435761u) & 0xFFFFFFF);
             }
+        });
+        add_bench_result(results, "metrics_record", rows, rows, record_time);
+
+        // One question-statistics update per row (a closed question: counter and answer time);
+        // the table takes 40 bytes a question, so the largest sizes are skipped
+        StatsStore counted;
+        counted.path = "bench_stats.qst";
+        const QuestionBank* counted_banks[6] = { nullptr, &qb };
+        remove(counted.path.c_str());
+        if (rows <= 1000000 && stats_store_open(counted, counted_banks)) {
+            double count_time = time_best(reps, [&] {
+                for (int64_t i = 0; i < rows; i++) {
+                    record_question_stats(counted, 1, (int)((uint64_t)(i * 2654435761u) % (uint64_t)qb.count),
+                        (AnswerResult)(i % 3 + 1), (uint64_t)i & 0xFFFFF);
+                }
+            });
+            add_bench_result(results, "stats_record", rows, rows, count_time);
+            stats_store_close(counted);
         }
-        else if (answer == 6) {
-            // Use skip lifeline
-            use_lifeline_skip();
-            cout << "\nPress Enter to Continue...";
-            cin.ignore();
-            cin.get();
-            return;
+        remove(counted.path.c_str());
+
+        // Inverted index over the bank, then word, multi-word and prefix queries
+        TextIndex index;
+        double index_time = time_best(reps, [&] { build_text_index(qb, index); });
+        add_bench_result(results, "search_index_build", rows, rows, index_time);
+        const char* search_queries[] = { "keyboard 42", "question number 7", "monit*", "printer cpu keyboard*" };
+        const int searches = 400;
+        double search_time = time_best(reps, [&] {
+            vector<uint32_t> ids;
+            for (int q = 0; q < searches; q++) {
+                checksum += search_text_index(index, search_queries[q % 4], ids, searchresults);
+            }
+        });
+        add_bench_result(results, "search_query", rows, searches, search_time);
+
+        // Near-duplicate scan: signatures, LSH buckets and clusters (signatures take
+        // 256 bytes a question, so the largest sizes are skipped)
+        if (rows <= 1000000) {
+            double duplicate_time = time_best(reps, [&] {
+                vector<vector<DuplicateMember>> clusters;
+                checksum += find_duplicate_clusters({ &qb }, duplicatethreshold, clusters);
+            });
+            add_bench_result(results, "duplicate_scan", rows, rows, duplicate_time);
         }
-        else if (answer == 7) {
-            // Use replace lifeline
-            if (lifeline_replace) {
-                use_lifeline_replace(indices[q_num], used_indices, used_count);
-                replace_requested = true;
+
+        // Adaptive answers: a pick near the player's rating, then both Elo updates
+        // (the index holds a tree node per question, so the largest sizes are skipped)
+        if (rows <= 1000000) {
+            RatingStore rated;
+            const QuestionBank* rated_banks[6] = { nullptr, &qb };
+            remove("bench_ratings.qrt");
+            if (rating_store_open(rated, "bench_ratings.qrt", rated_banks)) {
+                const int64_t answers = 100000;
+                for (uint64_t player = 1; player <= 64; player++) register_rating_player(rated, 1, player);
+                double adaptive_time = time_best(reps, [&] {
+                    for (int64_t i = 0; i < answers; i++) {
+                        uint64_t player = (uint64_t)(i % 64) + 1;
+                        int id = pick_rated_question(rated, 1, player, nullptr, 0, mix_hash((uint64_t)i), qb.count);
+                        rate_answer(rated, 1, id, player, mix_hash((uint64_t)i + 1) % 10 < 6);
+                        checksum += id;
+                    }
+                });
+                add_bench_result(results, "adaptive_answer", rows, answers, adaptive_time);
+                rating_store_close(rated);
             }
-            cout << "\n[Replace lifeline will load a new question in the next iteration]\n";
-            cout << "Press Enter to continue...";
-            cin.ignore();
-            cin.get();
-            return;
+            remove("bench_ratings.qrt");
         }
-        else if (answer == 8) {
-            // Use extra time lifeline
-            use_lifeline_extratime(current_timer);
-            cout << "\nNow answer (1-4): ";
-            answered_in_time = get_answer_with_timer(answer, current_timer);
-
-            if (!answered_in_time) {
-                // Timed out even with extra time
-                cout << "Time's up even after extra time!\n";
-                int negativemark = 0;
-                if (difficulty == 1) negativemark = 2;
-                else if (difficulty == 2) negativemark = 3;
-                else if (difficulty == 3) negativemark = 5;
-
-                score -= negativemark;
-                cout << "Negative Mark: -" << negativemark << " points\n";
-                streak = 0;
-                wrong_count++;
-
-                // Store for review
-                incorrect_questions[incorrect_count] = question;
-                for (int i = 0; i < 4; i++) {
-                    incorrect_options[incorrect_count][i] = shuffled_options[i];
+        close_question_bank(qb);
+
+        // show_high_scores(): read and rank the score file, then serve pages
+        write_bench_scores(scores_txt, rows);
+        double board_time = time_best(reps, [&] {
+            lock_guard<mutex> lock(leaderboard_mutex);
+            leaderboard = Leaderboard();
+            load_leaderboard(scores_txt);
+        });
+        add_bench_result(results, "leaderboard_load", rows, rows, board_time);
+        const int queries = 10000;
+        double page_time = time_best(reps, [&] {
+            const RankedList& list = leaderboard.views[0];
+            for (int q = 0; q < queries; q++) {
+                int node = list.node_at(q * 7919 % max(1, list.size) + 1);
+                for (int i = 0; i < leaderboardpage && node >= 0; i++) {
+                    checksum += leaderboard.entries[list.node_entry[node]].score;
+                    node = list.links[list.node_links[node]].next;
                 }
-                incorrect_correct_pos[incorrect_count] = new_correct;
-                incorrect_count++;
-
-                cout << "\nCurrent Score: " << score << "\n";
-                cout << "Press Enter to continue...";
-                cin.ignore();
-                cin.get();
-                return;
             }
+        });
+        add_bench_result(results, "leaderboard_page", rows, queries, page_time);
+        {
+            lock_guard<mutex> lock(leaderboard_mutex);
+            leaderboard = Leaderboard();
         }
-    }
 
-    // Handle timeout scenario
-    if (!answered_in_time) {
-        cout << "You didn't answer in time! Correct answer: " << shuffled_options[new_correct] << "\n";
+        // Score and session-log appends through the background writer
+        writer.paths[WRITER_SESSIONS] = out_logs;
+        writer.paths[WRITER_SCORES] = out_scores;
+        writer_start();
+        double enqueue_time = 0;
+        double append_time = time_best(reps, [&] {
+            auto t0 = chrono::steady_clock::now();
+            for (int64_t i = 0; i < rows; i++) {
+                string player = "player" + to_string(i % 1000);
+                writer_enqueue(WRITER_SCORES, player + "|-10|Science|Easy\n");
+
+                SessionRow row;
+                row.time = 1700000000 + i;
+                row.player = move(player);
+                row.category = (uint8_t)(i % 5 + 1);
+                row.difficulty = (uint8_t)(i % 3 + 1);
+                row.correct = 5;
+                row.wrong = 5;
+                row.score = -10;
+                writer_enqueue_session(move(row));
+            }
+            double queued = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+            if (enqueue_time == 0 || queued < enqueue_time) enqueue_time = queued;
+            writer_sync();
+        });
+        writer_stop();
+        add_bench_result(results, "append_enqueue", rows, rows * 2, enqueue_time);
+        add_bench_result(results, "append_drained", rows, rows * 2, append_time);
+        remove(out_logs.c_str());
+        remove(out_scores.c_str());
+    }
 
-        int negativemark = 0;
-        if (difficulty == 1) negativemark = 2;
-        else if (difficulty == 2) negativemark = 3;
-        else if (difficulty == 3) negativemark = 5;
+    remove(bank_txt.c_str());
+    remove(bank_qbk.c_str());
+    remove(scores_txt.c_str());
 
-        score -= negativemark;
-        cout << "Negative Mark: -" << negativemark << " points\n";
-        streak = 0;
-        wrong_count++;
+    if (!write_bench_json(json_name, results, checksum)) return 1;
+    cout << "Results written to " << json_name << "\n";
+    return 0;
+}
 
-        // Store for review
-        incorrect_questions[incorrect_count] = question;
-        for (int i = 0; i < 4; i++) {
-            incorrect_options[incorrect_count][i] = shuffled_options[i];
-        }
-        incorrect_correct_pos[incorrect_count] = new_correct;
-        incorrect_count++;
+// ======================= SCORING SIMULATOR ============================
+
+// Player populations every rule set is tried against
+const SkillModel skill_models[] = {
+    { "novice", 0.25, 0.45 },
+    { "average", 0.45, 0.75 },
+    { "expert", 0.75, 0.95 },
+    { "mixed", 0.25, 0.95 },
+};
+const int skillmodels = sizeof(skill_models) / sizeof(skill_models[0]);
+
+// ---------- Rule sets to sweep ----------
+vector<ScoringRules> scoring_rule_grid() {
+    static const int short_bonuses[] = { 0, 3, 5, 8 };
+    static const int long_bonuses[] = { 10, 15, 20 };
+    static const int penalties[][4] = { { 0, 1, 2, 3 }, { 0, 2, 3, 5 }, { 0, 3, 5, 8 } };
+
+    vector<ScoringRules> grid;
+    for (int reset = 1; reset >= 0; reset--)
+        for (const int* penalty : penalties)
+            for (int long_bonus : long_bonuses)
+                for (int short_bonus : short_bonuses) {
+                    ScoringRules rules;
+                    rules.short_bonus = short_bonus;
+                    rules.long_bonus = long_bonus;
+                    rules.reset_after_long = reset == 1;
+                    for (int level = 0; level < 4; level++) rules.penalty[level] = penalty[level];
+                    grid.push_back(rules);
+                }
+    return grid;
+}
 
-        cout << "\nCurrent Score: " << score << "\n";
-        cout << "Press Enter to continue...";
-        cin.ignore();
-        cin.get();
-        return;
+// ---------- Simulate one cell ----------
+void simulate_cell(SimCell& cell, const ScoringRules& rules, const SkillModel& model, int64_t rounds, uint64_t seed) {
+    // One array per field (lane l is player l); accuracy rises with l, so l is also the skill rank
+    alignas(64) uint32_t threshold[simlanes];
+    alignas(64) uint32_t state[simlanes];
+    alignas(64) int32_t score[simlanes];
+    alignas(64) int32_t streak[simlanes];
+    alignas(64) int32_t best[simlanes];
+
+    Pcg32 rng;
+    rng.seed(seed);
+    for (int l = 0; l < simlanes; l++) {
+        double accuracy = model.low + (model.high - model.low) * (l + 0.5) / simlanes;
+        threshold[l] = (uint32_t)(accuracy * 4294967295.0);
+        state[l] = rng.next() | 1;   // xorshift32 never leaves a nonzero state
+        best[l] = INT_MIN;
     }
 
-    // Convert to 0-based index
-    answer--;
-
-    int negativemark = 0;
-
-    // Check if answer is correct
-    if (answer == new_correct) {
-        cout << "\nCorrect!\n";
-        score++;
-        streak++;
-        correct_count++;
+    // The rules as plain ints so the lane loop below stays branch-free
+    const int32_t penalty = rules.penalty[cell.level];
+    const int32_t short_streak = rules.short_streak, short_bonus = rules.short_bonus;
+    const int32_t long_streak = rules.long_streak, long_bonus = rules.long_bonus;
+    const int32_t keep = rules.reset_after_long ? 0 : -1;
+    cell.min_score = -sessionquestions * penalty;
+    int max_score = sessionquestions * (1 + short_bonus + long_bonus);
+    cell.histogram.assign((size_t)(max_score - cell.min_score + 1), 0);
+
+    for (int64_t round = 0; round < rounds; round++) {
+        for (int l = 0; l < simlanes; l++) {
+            score[l] = 0;
+            streak[l] = 0;
+        }
 
-        // Apply streak bonuses
-        if (streak == 3) {
-            score += 5;
-            cout << "Streak Bonus +5 points!\n";
+        // Same rules as QuizSession::answer()/penalize(), written with masks so the
+        // compiler turns each question into a few vector instructions per lane group
+        for (int q = 0; q < sessionquestions; q++) {
+            for (int l = 0; l < simlanes; l++) {
+                uint32_t x = state[l];
+                x ^= x << 13;
+                x ^= x >> 17;
+                x ^= x << 5;
+                state[l] = x;
+
+                int32_t hit = -(int32_t)(x < threshold[l]);  // All ones on a correct answer
+                int32_t s = (streak[l] + 1) & hit;
+                int32_t bonus = (s == short_streak ? short_bonus : 0) + (s == long_streak ? long_bonus : 0);
+                streak[l] = s == long_streak ? s & keep : s;
+                score[l] += ((1 + bonus) & hit) | (-penalty & ~hit);
+            }
         }
-        else if (streak == 5) {
-            score += 15;
-            cout << "Streak Bonus +15 points!\n";
-            streak = 0;  // Reset after 5 streak
+
+        for (int l = 0; l < simlanes; l++) {
+            cell.histogram[score[l] - cell.min_score]++;
+            best[l] = max(best[l], score[l]);
         }
     }
-    else {
-        // Wrong answer
-        cout << "\nWrong! Correct answer: " << shuffled_options[new_correct] << "\n";
 
-        // Apply negative marking based on difficulty
-        if (difficulty == 1) negativemark = 2;
-        else if (difficulty == 2) negativemark = 3;
-        else if (difficulty == 3) negativemark = 5;
-
-        score -= negativemark;
-        cout << "Negative Mark: -" << negativemark << " points\n";
-        streak = 0;
-        wrong_count++;
+    // Leaderboard of each player's best score; equal scores fall in arbitrary order
+    vector<uint32_t> tiebreak(simlanes);
+    for (uint32_t& t : tiebreak) t = rng.next();
+    vector<int> ranked(simlanes);
+    for (int l = 0; l < simlanes; l++) ranked[l] = l;
+    sort(ranked.begin(), ranked.end(), [&](int a, int b) {
+        if (best[a] != best[b]) return best[a] > best[b];
+        return tiebreak[a] < tiebreak[b];
+    });
+
+    int skilled = 0;
+    for (int i = 0; i < 10; i++)
+        if (ranked[i] >= simlanes - simlanes / 10) skilled++;
+    cell.top10_skilled = skilled / 10.0;
+
+    double d2 = 0;
+    for (int i = 0; i < simlanes; i++) {
+        double d = (double)i - (simlanes - 1 - ranked[i]);  // Leaderboard rank minus skill rank
+        d2 += d * d;
+    }
+    cell.rank_correlation = 1 - 6 * d2 / ((double)simlanes * ((double)simlanes * simlanes - 1));
+}
 
-        // Store for review
-        incorrect_questions[incorrect_count] = question;
-        for (int i = 0; i < 4; i++) {
-            incorrect_options[incorrect_count][i] = shuffled_options[i];
-        }
-        incorrect_correct_pos[incorrect_count] = new_correct;
-        incorrect_count++;
+// ---------- Moments of a cell's scores ----------
+void histogram_moments(const SimCell& cell, double& mean, double& stddev, double& skew) {
+    double n = 0, sum = 0;
+    for (size_t i = 0; i < cell.histogram.size(); i++) {
+        n += (double)cell.histogram[i];
+        sum += (double)cell.histogram[i] * (cell.min_score + (int)i);
     }
+    mean = n > 0 ? sum / n : 0;
 
-    cout << "\nCurrent Score: " << score << "\n";
-    cout << "Press Enter to continue...";
-    cin.ignore();
-    cin.get();
+    double m2 = 0, m3 = 0;
+    for (size_t i = 0; i < cell.histogram.size(); i++) {
+        double d = cell.min_score + (int)i - mean;
+        m2 += (double)cell.histogram[i] * d * d;
+        m3 += (double)cell.histogram[i] * d * d * d;
+    }
+    m2 = n > 0 ? m2 / n : 0;
+    m3 = n > 0 ? m3 / n : 0;
+    stddev = sqrt(m2);
+    skew = m2 > 0 ? m3 / (m2 * stddev) : 0;
 }
 
-// ======================= HIGH SCORES ============================
+// ---------- Percentile of a cell's scores ----------
+int histogram_percentile(const SimCell& cell, double fraction) {
+    int64_t total = 0;
+    for (int64_t count : cell.histogram) total += count;
+    int64_t target = (int64_t)(fraction * (total - 1));
+    int64_t seen = 0;
+    for (size_t i = 0; i < cell.histogram.size(); i++) {
+        seen += cell.histogram[i];
+        if (seen > target) return cell.min_score + (int)i;
+    }
+    return cell.min_score + (int)cell.histogram.size() - 1;
+}
 
-// ---------- Save high score to file ----------
-void save_high_score(string player, int score, string category, string difficulty) {
-    ofstream fout("high_scores.txt", ios::app);  // Append mode
+// ---------- Sweep results as JSON ----------
+bool write_simulation_json(string name, const vector<SimCell>& cells, const vector<ScoringRules>& grid,
+    const SkillModel* models, int64_t rounds, double seconds) {
+    ofstream fout(name);
     if (!fout.is_open()) {
-        cout << "Error opening high_scores.txt\n";
-        return;
+        cout << "Error opening " << name << "\n";
+        return false;
     }
 
-    // Write in pipe-delimited format
-    fout << player << "|" << score << "|" << category << "|" << difficulty << "\n";
-    fout.close();
+    char number[320];
+    fout << "{\n  \"suite\": \"scoring-simulation\",\n  \"date\": \"" << get_current_datetime() << "\",\n";
+    fout << "  \"sessions_per_cell\": " << rounds * simlanes << ", \"players_per_cell\": " << simlanes;
+    sprintf_s(number, "%.3f", seconds);
+    fout << ", \"seconds\": " << number << ",\n  \"cells\": [\n";
+    for (size_t i = 0; i < cells.size(); i++) {
+        const SimCell& c = cells[i];
+        const ScoringRules& r = grid[c.rules];
+        double mean, stddev, skew;
+        histogram_moments(c, mean, stddev, skew);
+
+        fout << "    {\"rules\": {\"short_streak\": " << r.short_streak << ", \"short_bonus\": " << r.short_bonus <<
+            ", \"long_streak\": " << r.long_streak << ", \"long_bonus\": " << r.long_bonus << ", \"reset\": " <<
+            (r.reset_after_long ? "true" : "false") << ", \"penalty\": " << r.penalty[c.level] << "},\n";
+        fout << "     \"skill\": \"" << models[c.model].name << "\", \"difficulty\": \"" << difficulty_name(c.level) << "\"";
+        sprintf_s(number, ", \"mean\": %.4f, \"stddev\": %.4f, \"skewness\": %.4f, \"top10_skilled\": %.2f, \"rank_correlation\": %.4f",
+            mean, stddev, skew, c.top10_skilled, c.rank_correlation);
+        fout << number << ",\n     \"percentiles\": {\"p1\": " << histogram_percentile(c, 0.01) << ", \"p10\": " <<
+            histogram_percentile(c, 0.10) << ", \"p50\": " << histogram_percentile(c, 0.50) << ", \"p90\": " <<
+            histogram_percentile(c, 0.90) << ", \"p99\": " << histogram_percentile(c, 0.99) << "},\n";
+
+        // Only the span of scores that occurred
+        size_t first = 0, last = c.histogram.size();
+        while (first < last && c.histogram[first] == 0) first++;
+        while (last > first && c.histogram[last - 1] == 0) last--;
+        fout << "     \"histogram\": {\"min\": " << c.min_score + (int)first << ", \"counts\": [";
+        for (size_t h = first; h < last; h++) fout << (h > first ? ", " : "") << c.histogram[h];
+        fout << "]}}" << (i + 1 < cells.size() ? "," : "") << "\n";
+    }
+    fout << "  ]\n}\n";
+    return true;
 }
 
-// ---------- Display all high scores sorted by score ----------
-void show_high_scores() {
-    const int maxentries = 100;
-    string player[maxentries];
-    int score[maxentries];
-    string category[maxentries];
-    string difficulty[maxentries];
+// ---------- Scoring-rule simulator ----------
+int run_simulator(int64_t sessions, int threads, string json_name) {
+    if (sessions < simlanes) sessions = simlanes;
+    if (threads < 1) threads = 1;
+    int64_t rounds = (sessions + simlanes - 1) / simlanes;
+    vector<ScoringRules> grid = scoring_rule_grid();
+
+    // Every rule set against every population at every difficulty
+    vector<SimCell> cells;
+    for (int r = 0; r < (int)grid.size(); r++)
+        for (int m = 0; m < skillmodels; m++)
+            for (int level = 1; level <= 3; level++) {
+                SimCell cell;
+                cell.rules = r;
+                cell.model = m;
+                cell.level = level;
+                cells.push_back(cell);
+            }
+    cout << "Simulating " << cells.size() << " cells (" << grid.size() << " rule sets x " << skillmodels <<
+        " skill models x 3 difficulties), " << rounds * simlanes << " sessions each, on " << threads << " threads\n";
+
+    // Cells are handed out one at a time; each is seeded by its index, so results do not depend on threads
+    atomic<size_t> next_cell(0);
+    auto start = chrono::steady_clock::now();
+    vector<thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.push_back(thread([&] {
+            for (size_t i = next_cell++; i < cells.size(); i = next_cell++) {
+                SimCell& cell = cells[i];
+                simulate_cell(cell, grid[cell.rules], skill_models[cell.model], rounds, 0x5eed0000ull + i);
+            }
+        }));
+    }
+    for (auto& w : workers) w.join();
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    double total = (double)cells.size() * rounds * simlanes;
+    cout << "Played " << total << " sessions in " << seconds << " s (" << (seconds > 0 ? total / seconds : 0) <<
+        " sessions/s)\n\n";
+
+    // The rules the game plays by now, then the fairest alternatives for a mixed population
+    int current = 0;
+    for (int r = 0; r < (int)grid.size(); r++) {
+        const ScoringRules& g = grid[r];
+        if (g.short_bonus == scoring.short_bonus && g.long_bonus == scoring.long_bonus &&
+            g.reset_after_long == scoring.reset_after_long && equal(g.penalty, g.penalty + 4, scoring.penalty)) current = r;
+    }
+    char line[200];
+    auto print_cell = [&](const SimCell& c) {
+        double mean, stddev, skew;
+        histogram_moments(c, mean, stddev, skew);
+        const ScoringRules& r = grid[c.rules];
+        sprintf_s(line, "%-8s %-7s +%d@%d +%d@%d%s -%d  mean %6.2f  sd %5.2f  skew %5.2f  p10/50/90 %4d %4d %4d  top10 %.1f  rho %.3f",
+            skill_models[c.model].name, difficulty_name(c.level).c_str(), r.short_bonus, r.short_streak, r.long_bonus,
+            r.long_streak, r.reset_after_long ? " reset" : "      ", r.penalty[c.level], mean, stddev, skew,
+            histogram_percentile(c, 0.10), histogram_percentile(c, 0.50), histogram_percentile(c, 0.90),
+            c.top10_skilled, c.rank_correlation);
+        cout << line << "\n";
+    };
+    cout << "Current rules:\n";
+    for (const SimCell& c : cells)
+        if (c.rules == current) print_cell(c);
+
+    vector<const SimCell*> mixed;
+    for (const SimCell& c : cells)
+        if (c.model == skillmodels - 1 && c.level == 2) mixed.push_back(&c);
+    sort(mixed.begin(), mixed.end(), [](const SimCell* a, const SimCell* b) { return a->rank_correlation > b->rank_correlation; });
+    cout << "\nLeaderboard closest to skill order (mixed players, Medium):\n";
+    for (size_t i = 0; i < mixed.size() && i < 5; i++) print_cell(*mixed[i]);
+
+    if (!write_simulation_json(json_name, cells, grid, skill_models, rounds, seconds)) return 1;
+    cout << "\nResults written to " << json_name << "\n";
+    return 0;
+}
 
-    int count = 0;
+// ======================= FULL-TEXT SEARCH ============================
 
-    ifstream fin("high_scores.txt");
-    if (!fin.is_open()) {
-        cout << "No high scores found!\nPress Enter...";
-        cin.ignore();
-        cin.get();
-        return;
+// ---------- Next word of a text ----------
+bool next_search_token(string_view text, size_t& pos, string& token) {
+    token.clear();
+    while (pos < text.size() && !isalnum((unsigned char)text[pos])) pos++;
+    while (pos < text.size() && isalnum((unsigned char)text[pos])) {
+        token += (char)tolower((unsigned char)text[pos]);
+        pos++;
     }
+    return !token.empty();
+}
 
-    // Read all high score entries
-    string line;
-    while (getline(fin, line) && count < maxentries) {
-        string temp = line;
-        player[count] = cut(temp);
-        score[count] = stoi(cut(temp));
-        category[count] = cut(temp);
-        difficulty[count] = cut(temp);
-        count++;
+// ---------- Build a bank's inverted index ----------
+void build_text_index(const QuestionBank& qb, TextIndex& index) {
+    // Each pooled string is split once, however many questions share it
+    StringPool words;
+    words.slots.assign(1024, 0);
+    vector<uint32_t> string_words_start(qb.string_count + 1, 0);
+    vector<uint32_t> string_words;
+    string token;
+    for (int sid = 0; sid < qb.string_count; sid++) {
+        string_words_start[sid] = (uint32_t)string_words.size();
+        string_view text(qb.strings + qb.string_offsets[sid], qb.string_offsets[sid + 1] - qb.string_offsets[sid]);
+        size_t pos = 0;
+        while (next_search_token(text, pos, token)) string_words.push_back(intern_string(words, token));
+    }
+    string_words_start[qb.string_count] = (uint32_t)string_words.size();
+    uint32_t word_count = (uint32_t)(words.offsets.size() - 1);
+
+    // Two passes over the questions (count, then fill) lay postings out by word;
+    // IDs are visited in order, so every list comes out sorted
+    vector<uint32_t> start(word_count + 1, 0);
+    vector<uint32_t> question_words;
+    auto collect = [&](int id) {
+        question_words.clear();
+        const BankRecord& rec = qb.records[id];
+        for (int f = 0; f < 5; f++) {
+            question_words.insert(question_words.end(), string_words.begin() + string_words_start[rec.text[f]],
+                string_words.begin() + string_words_start[rec.text[f] + 1]);
+        }
+        sort(question_words.begin(), question_words.end());
+        question_words.erase(unique(question_words.begin(), question_words.end()), question_words.end());
+    };
+    for (int id = 0; id < qb.count; id++) {
+        collect(id);
+        for (uint32_t w : question_words) start[w + 1]++;
+    }
+    for (uint32_t w = 0; w < word_count; w++) start[w + 1] += start[w];
+    vector<uint32_t> postings(start[word_count]);
+    vector<uint32_t> fill_at(start.begin(), start.end() - 1);
+    for (int id = 0; id < qb.count; id++) {
+        collect(id);
+        for (uint32_t w : question_words) postings[fill_at[w]++] = (uint32_t)id;
+    }
+
+    // Terms in sorted order, each with its list or bitmap
+    auto word_text = [&](uint32_t w) {
+        return string_view(words.bytes.data() + words.offsets[w], words.offsets[w + 1] - words.offsets[w]);
+    };
+    vector<uint32_t> sorted(word_count);
+    for (uint32_t w = 0; w < word_count; w++) sorted[w] = w;
+    sort(sorted.begin(), sorted.end(), [&](uint32_t a, uint32_t b) { return word_text(a) < word_text(b); });
+
+    index = TextIndex();
+    index.questions = qb.count;
+    index.terms.reserve(words.bytes.size());
+    index.term_offsets.reserve(word_count + 1);
+    index.term_count.reserve(word_count);
+    index.term_start.reserve(word_count);
+    size_t words_per_bitmap = ((size_t)qb.count + 63) / 64;
+    for (uint32_t w : sorted) {
+        uint32_t count = start[w + 1] - start[w];
+        index.term_offsets.push_back((uint32_t)index.terms.size());
+        index.terms += word_text(w);
+        index.term_count.push_back(count);
+        if ((uint64_t)count * densepostings >= (uint64_t)qb.count) {
+            index.term_start.push_back(index.bitmaps.size());
+            index.bitmaps.resize(index.bitmaps.size() + words_per_bitmap, 0);
+            uint64_t* bits = index.bitmaps.data() + index.term_start.back();
+            for (uint32_t p = start[w]; p < start[w + 1]; p++) bits[postings[p] >> 6] |= 1ull << (postings[p] & 63);
+        } else {
+            index.term_start.push_back(index.postings.size());
+            index.postings.insert(index.postings.end(), postings.begin() + start[w], postings.begin() + start[w + 1]);
+        }
+    }
+    index.term_offsets.push_back((uint32_t)index.terms.size());
+}
+
+// ---------- Index a bank as it loads ----------
+void index_bank(QuestionBank& qb) {
+    if (!bank_indexing || qb.count == 0) return;
+    shared_ptr<TextIndex> index = make_shared<TextIndex>();
+    build_text_index(qb, *index);
+    qb.index = index;
+}
+
+// ---------- Matches of a term or prefix ----------
+SearchTerm search_term(const TextIndex& index, string_view term, bool prefix, vector<uint32_t>& scratch_ids,
+    vector<uint64_t>& scratch_bits) {
+    // Binary search for the first term >= the query term
+    size_t terms = index.term_count.size();
+    auto term_at = [&](size_t t) {
+        return string_view(index.terms.data() + index.term_offsets[t], index.term_offsets[t + 1] - index.term_offsets[t]);
+    };
+    size_t low = 0, high = terms;
+    while (low < high) {
+        size_t mid = (low + high) / 2;
+        if (term_at(mid) < term) low = mid + 1;
+        else high = mid;
+    }
+
+    size_t last = low;
+    if (!prefix) {
+        if (low < terms && term_at(low) == term) last = low + 1;
+    } else {
+        while (last < terms && term_at(last).substr(0, term.size()) == term) last++;
     }
-    fin.close();
 
-    // Bubble sort in descending order by score
-    for (int i = 0; i < count - 1; i++) {
-        for (int j = 0; j < count - i - 1; j++) {
-            if (score[j] < score[j + 1]) {
-                swap(score[j], score[j + 1]);// Swapping in descending order 
-                swap(player[j], player[j + 1]);
-                swap(category[j], category[j + 1]);
-                swap(difficulty[j], difficulty[j + 1]);
+    auto term_matches = [&](size_t t) {
+        SearchTerm match;
+        match.count = index.term_count[t];
+        if ((uint64_t)match.count * densepostings >= (uint64_t)index.questions) match.bits = index.bitmaps.data() + index.term_start[t];
+        else match.ids = index.postings.data() + index.term_start[t];
+        return match;
+    };
+    SearchTerm match;
+    if (last == low) return match;
+    if (last == low + 1) return term_matches(low);
+
+    // Several terms share the prefix: merged into a bitmap if the union may be common, else a list
+    uint64_t total = 0;
+    for (size_t t = low; t < last; t++) total += index.term_count[t];
+    if (total * densepostings >= (uint64_t)index.questions) {
+        scratch_bits.assign(((size_t)index.questions + 63) / 64, 0);
+        for (size_t t = low; t < last; t++) {
+            SearchTerm part = term_matches(t);
+            if (part.bits != nullptr) {
+                for (size_t w = 0; w < scratch_bits.size(); w++) scratch_bits[w] |= part.bits[w];
+            } else {
+                for (size_t i = 0; i < part.count; i++) scratch_bits[part.ids[i] >> 6] |= 1ull << (part.ids[i] & 63);
             }
         }
+        match.bits = scratch_bits.data();
+        for (uint64_t word : scratch_bits) match.count += bitset<64>(word).count();
+        return match;
+    }
+    scratch_ids.clear();
+    for (size_t t = low; t < last; t++) {
+        SearchTerm part = term_matches(t);
+        scratch_ids.insert(scratch_ids.end(), part.ids, part.ids + part.count);
     }
-    // Show High Score
+    sort(scratch_ids.begin(), scratch_ids.end());
+    scratch_ids.erase(unique(scratch_ids.begin(), scratch_ids.end()), scratch_ids.end());
+    match.ids = scratch_ids.data();
+    match.count = scratch_ids.size();
+    return match;
+}
 
-    cout << "========================================\n";
-    cout << "               HIGH SCORES\n";
-    cout << "========================================\n\n";
-    cout << "Player\tScore\tCategory\tDifficulty\n";
+// ---------- Intersect a result with a posting list ----------
+void intersect_postings(vector<uint32_t>& acc, const uint32_t* list, size_t count) {
+    size_t kept = 0, at = 0;
+    for (size_t i = 0; i < acc.size() && at < count; i++) {
+        uint32_t id = acc[i];
+        // Gallop: double the step until it passes id, then binary search the last step
+        size_t step = 1;
+        while (at + step < count && list[at + step] < id) step *= 2;
+        at = lower_bound(list + at, list + min(at + step + 1, count), id) - list;
+        if (at < count && list[at] == id) acc[kept++] = id;
+    }
+    acc.resize(kept);
+}
 
-    for (int i = 0; i < count; i++) {
-        cout << player[i] << "\t" << score[i] << "\t" << category[i] << "\t\t" << difficulty[i] << "\n";
+// ---------- Search one bank's index ----------
+size_t search_text_index(const TextIndex& index, string_view query, vector<uint32_t>& ids, size_t limit) {
+    ids.clear();
+
+    // Every query word's matches; "*" right after a word makes it a prefix
+    vector<SearchTerm> lists, dense;
+    vector<vector<uint32_t>> scratch_ids;
+    vector<vector<uint64_t>> scratch_bits;
+    string token;
+    size_t pos = 0;
+    while (next_search_token(query, pos, token)) {
+        bool prefix = pos < query.size() && query[pos] == '*';
+        scratch_ids.emplace_back();
+        scratch_bits.emplace_back();
+        SearchTerm match = search_term(index, token, prefix, scratch_ids.back(), scratch_bits.back());
+        if (match.count == 0) return 0;
+        (match.bits != nullptr ? dense : lists).push_back(match);
+    }
+    if (lists.empty() && dense.empty()) return 0;
+
+    if (lists.empty()) {
+        // Only common words: AND the bitmaps a word at a time, count, and list the first matches
+        size_t total = 0;
+        for (size_t w = 0; w < ((size_t)index.questions + 63) / 64; w++) {
+            uint64_t word = dense[0].bits[w];
+            for (size_t d = 1; d < dense.size(); d++) word &= dense[d].bits[w];
+            total += bitset<64>(word).count();
+            for (; word != 0 && ids.size() < limit; word &= word - 1) {
+                int bit = 0;
+                while (((word >> bit) & 1) == 0) bit++;
+                ids.push_back((uint32_t)(w * 64 + bit));
+            }
+        }
+        return total;
     }
 
-    cout << "\nPress Enter to return...";
-    cin.ignore();
-    cin.get();
+    // Otherwise the shortest list drives: other lists are galloped through, bitmaps probed
+    sort(lists.begin(), lists.end(), [](const SearchTerm& a, const SearchTerm& b) { return a.count < b.count; });
+    ids.assign(lists[0].ids, lists[0].ids + lists[0].count);
+    for (size_t i = 1; i < lists.size() && !ids.empty(); i++) intersect_postings(ids, lists[i].ids, lists[i].count);
+    for (const SearchTerm& d : dense) {
+        size_t kept = 0;
+        for (uint32_t id : ids)
+            if ((d.bits[id >> 6] >> (id & 63)) & 1) ids[kept++] = id;
+        ids.resize(kept);
+    }
+    size_t total = ids.size();
+    if (ids.size() > limit) ids.resize(limit);
+    return total;
 }
 
-// ======================= POST QUIZ MENU ============================
+// ---------- Search mode ----------
+int run_search(string query, int cat) {
+    int first = cat >= 1 && cat <= 5 ? cat : 1, last = cat >= 1 && cat <= 5 ? cat : 5;
 
-// ---------- post quiz menu ----------
-void post_quiz_menu() {
-    while (true) {
-        system("cls");
-        cout << "========================================\n";
-        cout << "           QUIZ COMPLETE!\n";
-        cout << "========================================\n";
-        cout << "Your Final Score: " << score << "/" << sessionquestions << "\n";
-        cout << "Correct Answers: " << correct_count << "\n";
-        cout << "Wrong Answers: " << wrong_count << "\n\n";
-
-        cout << "1. Review Incorrect Questions\n";
-        cout << "2. Replay Quiz (New Questions)\n";
-        cout << "3. Return to Main Menu\n";
-        cout << "Enter choice: ";
+    // Every bank is indexed by the cache as it loads (and again on each reload),
+    // so every query runs in memory
+    bank_indexing = true;
+    if (load_bank_cache() == 0) {
+        cout << "Failed to load question banks: " << bank_cache_report() << "\n";
+        return 1;
+    }
+    uint64_t postings = 0, terms = 0;
+    for (int c = first; c <= last; c++) {
+        shared_ptr<const QuestionBank> bank = acquire_bank(c);
+        if (bank == nullptr) continue;
+        for (uint32_t n : bank->index->term_count) postings += n;
+        terms += bank->index->term_count.size();
+    }
+    cout << "Indexed " << bank_cache_report() << ": " << terms << " terms, " << postings << " postings\n";
 
-        int choice;
-        cin >> choice;
-        cin.ignore();
+    // Typed queries see edited banks as soon as they are reloaded
+    bool interactive = query.empty();
+    bank_watching = interactive;
+    thread watcher;
+    if (interactive) watcher = thread(watch_question_banks, true);
 
-        if (choice == 1) {
-            review_incorrect_questions();// To show incorrect questions
-        }
-        else if (choice == 2) {
-            // Replay quiz with new questions
-            streak = 0;
-            timer = 15;
-            incorrect_count = 0;
-            correct_count = 0;
-            wrong_count = 0;
-            reset_lifelines();
-            start_quiz();
-            return;
-        }
-        else if (choice == 3) {
-            return;
+    vector<uint32_t> ids;
+    while (true) {
+        if (interactive) {
+            cout << "\nSearch (words, word* for a prefix; empty line to quit): ";
+            if (!getline(cin, query) || query.empty()) break;
         }
-        else {
-            cout << "Invalid choice. Press Enter...";
-            cin.ignore();
+
+        int total = 0, shown = 0;
+        double query_ms = 0;
+        for (int c = first; c <= last; c++) {
+            shared_ptr<const QuestionBank> bank = acquire_bank(c);
+            if (bank == nullptr) continue;
+            auto t0 = chrono::steady_clock::now();
+            total += (int)search_text_index(*bank->index, query, ids, searchresults - shown);
+            query_ms += chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+
+            for (size_t i = 0; i < ids.size(); i++, shown++) {
+                QuestionView view = get_question(*bank, (int)ids[i]);
+                cout << category_name(c) << " #" << ids[i] << " (" << difficulty_name(view.difficulty) << ") " <<
+                    string_view(view.text[0], view.length[0]) << "\n    ";
+                for (int o = 1; o <= 4; o++) {
+                    cout << o << ") " << string_view(view.text[o], view.length[o]) << (o - 1 == view.correct ? "*" : "") << "  ";
+                }
+                cout << "\n";
+            }
         }
+        cout << total << " match(es)" << (total > shown ? ", first " + to_string(shown) + " shown" : "") << ", " <<
+            query_ms << " ms\n";
+        if (!interactive) break;
     }
+
+    bank_watching = false;
+    if (watcher.joinable()) watcher.join();
+    release_bank_cache();
+    return 0;
 }
 
-// ======================= QUIZ LOGIC ============================
+// ======================= DUPLICATE DETECTION ============================
 
-// ---------- main quiz function ----------
-void start_quiz() {
-    switch (category) {
-    case 1: filename = "science.txt"; break;
-    case 2: filename = "computer.txt"; break;
-    case 3: filename = "sports.txt"; break;
-    case 4: filename = "history.txt"; break;
-    case 5: filename = "iq.txt"; break;
-    }
+// ---------- Finish a 64-bit hash ----------
+uint64_t mix_hash(uint64_t x) {
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
 
-    int loaded = load_questions(filename);
-    if (loaded == 0) {
-        cout << "Failed to load questions.\nPress Enter...";
-        cin.ignore();
-        cin.get();
-        return;
+// ---------- MinHash signatures of a bank ----------
+void minhash_bank(const QuestionBank& qb, uint32_t* signatures) {
+    // Value k of a shingle is the high half of its hash times an odd multiplier
+    uint64_t multipliers[minhashes];
+    for (int k = 0; k < minhashes; k++) multipliers[k] = mix_hash((k + 1) * 0x9e3779b97f4a7c15ull) | 1;
+
+    // Word hashes of every pooled string, split once however many questions share it
+    vector<uint32_t> word_start(qb.string_count + 1, 0);
+    vector<uint64_t> words;
+    string token;
+    for (int sid = 0; sid < qb.string_count; sid++) {
+        word_start[sid] = (uint32_t)words.size();
+        string_view text(qb.strings + qb.string_offsets[sid], qb.string_offsets[sid + 1] - qb.string_offsets[sid]);
+        size_t pos = 0;
+        while (next_search_token(text, pos, token)) words.push_back(mix_hash(hash_key(token)));
+    }
+    word_start[qb.string_count] = (uint32_t)words.size();
+
+    // Options repeat across questions ("True", "1945"), so each option string's
+    // values are computed once and a question takes the minimum over its four
+    vector<uint32_t> option_values((size_t)qb.string_count * optionhashes, UINT32_MAX);
+    vector<bool> done(qb.string_count, false);
+    for (int id = 0; id < qb.count; id++) {
+        for (int o = 1; o <= 4; o++) {
+            uint32_t sid = qb.records[id].text[o];
+            if (done[sid]) continue;
+            done[sid] = true;
+            uint32_t* values = &option_values[(size_t)sid * optionhashes];
+            for (uint32_t w = word_start[sid]; w < word_start[sid + 1]; w++) {
+                for (int k = 0; k < optionhashes; k++) {
+                    values[k] = min(values[k], (uint32_t)((words[w] * multipliers[stemhashes + k]) >> 32));
+                }
+            }
+        }
     }
 
-    used_count = 0;
-    int startindex = (difficulty - 1) * 50;
-    for (int i = 0; i < 50; i++) indices[i] = startindex + i;
-
-    shuffle_array(indices, 50);
-    score = 0;
+    // Question text is the bulk of the work and shares nothing, so it is split across cores
+    int threads = max(1, (int)thread::hardware_concurrency());
+    vector<thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.push_back(thread([&, t] {
+            int first = (int)((int64_t)qb.count * t / threads), last = (int)((int64_t)qb.count * (t + 1) / threads);
+            for (int id = first; id < last; id++) {
+                uint32_t* sig = signatures + (size_t)id * minhashes;
+                for (int k = 0; k < minhashes; k++) sig[k] = UINT32_MAX;
+                auto shingle = [&](uint64_t h) {
+                    for (int k = 0; k < stemhashes; k++) sig[k] = min(sig[k], (uint32_t)((h * multipliers[k]) >> 32));
+                };
+
+                // The text's shingles are its words and adjacent word pairs, so word order counts a little
+                const BankRecord& rec = qb.records[id];
+                uint32_t begin = word_start[rec.text[0]], end = word_start[rec.text[0] + 1];
+                for (uint32_t w = begin; w < end; w++) {
+                    shingle(words[w]);
+                    if (w + 1 < end) shingle(mix_hash(words[w] * 3 + words[w + 1]));
+                }
+                for (int o = 1; o <= 4; o++) {
+                    const uint32_t* values = &option_values[(size_t)rec.text[o] * optionhashes];
+                    for (int k = 0; k < optionhashes; k++) sig[stemhashes + k] = min(sig[stemhashes + k], values[k]);
+                }
+            }
+        }));
+    }
+    for (auto& t : workers) t.join();
+}
 
-    for (int q = 0; q < sessionquestions; ) {
-        system("cls");
-        string line = questions[indices[q]];
-        string question = cut(line);
-        string a = cut(line), b = cut(line), c = cut(line), d = cut(line);
-        string correct_str = cut(line);
+// ---------- Estimated similarity of two questions ----------
+double signature_similarity(const uint32_t* a, const uint32_t* b) {
+    int equal = 0;
+    for (int k = 0; k < minhashes; k++) equal += a[k] == b[k];
+    return (double)equal / minhashes;
+}
 
-        if (correct_str.empty() || question.empty()) {
-            cout << "Error: Invalid question format!\n";
-            cout << "Press Enter to skip...";
-            cin.ignore();
-            cin.get();
-            continue;
+// ---------- Cluster near-duplicate questions ----------
+size_t find_duplicate_clusters(const vector<const QuestionBank*>& banks, double threshold,
+    vector<vector<DuplicateMember>>& clusters) {
+    // Questions are numbered bank by bank; base[b] is the first of bank b
+    vector<uint32_t> base(banks.size() + 1, 0);
+    for (size_t b = 0; b < banks.size(); b++) base[b + 1] = base[b] + (uint32_t)banks[b]->count;
+    uint32_t total = base.back();
+    vector<uint32_t> signatures((size_t)total * minhashes);
+    for (size_t b = 0; b < banks.size(); b++) minhash_bank(*banks[b], signatures.data() + (size_t)base[b] * minhashes);
+
+    // Union-find over questions; the root of a cluster is its lowest-numbered question
+    vector<uint32_t> parent(total);
+    for (uint32_t q = 0; q < total; q++) parent[q] = q;
+    auto find = [&](uint32_t q) {
+        while (parent[q] != q) q = parent[q] = parent[parent[q]];
+        return q;
+    };
+
+    // LSH: questions agreeing on all lshrows values of a band share its bucket, so only
+    // likely pairs are compared. Each question is checked against its bucket's first;
+    // a pair missed that way nearly always meets in another band
+    vector<pair<uint64_t, uint32_t>> buckets(total);
+    size_t compared = 0;
+    for (int band = 0; band < lshbands; band++) {
+        for (uint32_t q = 0; q < total; q++) {
+            const uint32_t* v = &signatures[(size_t)q * minhashes + band * lshrows];
+            buckets[q] = { mix_hash(((uint64_t)v[0] << 32 | v[1]) ^ mix_hash((uint64_t)v[2] << 32 | v[3])), q };
         }
+        sort(buckets.begin(), buckets.end());
+        for (size_t s = 0, e; s < buckets.size(); s = e) {
+            uint32_t head = buckets[s].second;
+            for (e = s + 1; e < buckets.size() && buckets[e].first == buckets[s].first; e++) {
+                uint32_t a = find(head), b = find(buckets[e].second);
+                if (a == b) continue;
+                compared++;
+                if (signature_similarity(&signatures[(size_t)head * minhashes],
+                    &signatures[(size_t)buckets[e].second * minhashes]) >= threshold) parent[max(a, b)] = min(a, b);
+            }
+        }
+    }
 
-        int correct = stoi(correct_str) - 1;
-
-        string options[4] = { a, b, c, d };
+    // Clusters in order of their first question, then largest first
+    vector<uint32_t> size(total, 0), cluster_of(total, UINT32_MAX);
+    for (uint32_t q = 0; q < total; q++) size[find(q)]++;
+    clusters.clear();
+    int bank = 0;
+    for (uint32_t q = 0; q < total; q++) {
+        while (q >= base[bank + 1]) bank++;
+        uint32_t root = find(q);
+        if (size[root] < 2) continue;
+        if (cluster_of[root] == UINT32_MAX) {
+            cluster_of[root] = (uint32_t)clusters.size();
+            clusters.emplace_back();
+        }
+        DuplicateMember member;
+        member.bank = bank;
+        member.id = q - base[bank];
+        member.similarity = signature_similarity(&signatures[(size_t)root * minhashes], &signatures[(size_t)q * minhashes]);
+        clusters[cluster_of[root]].push_back(member);
+    }
+    stable_sort(clusters.begin(), clusters.end(),
+        [](const vector<DuplicateMember>& a, const vector<DuplicateMember>& b) { return a.size() > b.size(); });
+    return compared;
+}
 
-        cout << "Question " << q + 1 << " of " << sessionquestions << "\n\n";
-        display_question(question, options, correct, q, false);
+// ---------- Duplicate report ----------
+int run_duplicates(double threshold, string report_name) {
+    if (load_bank_cache() == 0) {
+        cout << "Failed to load question banks: " << bank_cache_report() << "\n";
+        return 1;
+    }
+    shared_ptr<const QuestionBank> held[6];
+    vector<const QuestionBank*> banks;
+    vector<int> cats;
+    for (int cat = 1; cat <= 5; cat++) {
+        held[cat] = acquire_bank(cat);
+        if (held[cat] == nullptr) continue;
+        banks.push_back(held[cat].get());
+        cats.push_back(cat);
+    }
 
-        if (replace_requested) {
-            replace_requested = false;
-            continue;
+    auto t0 = chrono::steady_clock::now();
+    vector<vector<DuplicateMember>> clusters;
+    size_t compared = find_duplicate_clusters(banks, threshold, clusters);
+    double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+
+    int questions = 0, across = 0;
+    for (const auto& cluster : clusters) {
+        questions += (int)cluster.size();
+        for (const DuplicateMember& m : cluster) {
+            if (m.bank != cluster[0].bank) {
+                across++;
+                break;
+            }
         }
-        // Mark question as completed
-        used_indices[used_count++] = indices[q];
-        q++;
     }
-    string category_str = (category == 1 ? "Science" :
-        category == 2 ? "Computer" :
-        category == 3 ? "Sports" :
-        category == 4 ? "History" : "IQ");
 
-    string difficulty_str = (difficulty == 1 ? "Easy" :
-        difficulty == 2 ? "Medium" : "Hard");
+    // One line per question: where it is, its similarity to the cluster's first, and its text
+    auto describe = [&](const DuplicateMember& m) {
+        QuestionView view = get_question(*banks[m.bank], (int)m.id);
+        char similarity[16];
+        sprintf_s(similarity, "%.2f", m.similarity);
+        string line = category_name(cats[m.bank]) + " #" + to_string(m.id) + " (" + difficulty_name(view.difficulty) +
+            ") " + similarity + "  " + string(view.text[0], view.length[0]) + " [";
+        for (int o = 1; o <= 4; o++) line += (o > 1 ? " / " : "") + string(view.text[o], view.length[o]);
+        return line + "]";
+    };
+
+    ofstream report(report_name);
+    if (!report.is_open()) {
+        cout << "Error opening " << report_name << "\n";
+        release_bank_cache();
+        return 1;
+    }
+    report << "Near-duplicate clusters at similarity " << threshold << " or more, largest first\n";
+    for (size_t c = 0; c < clusters.size(); c++) {
+        report << "\nCluster " << c + 1 << ": " << clusters[c].size() << " questions\n";
+        for (const DuplicateMember& m : clusters[c]) report << "  " << describe(m) << "\n";
+    }
+    report.close();
+
+    cout << "Fingerprinted " << bank_cache_report() << " and checked " << compared << " candidate pairs in " << ms <<
+        " ms\n";
+    cout << clusters.size() << " near-duplicate cluster(s) covering " << questions << " questions, " << across <<
+        " spanning categories; all written to " << report_name << "\n";
+    for (size_t c = 0; c < clusters.size() && c < (size_t)duplicatesshown; c++) {
+        cout << "\nCluster " << c + 1 << ": " << clusters[c].size() << " questions\n";
+        for (const DuplicateMember& m : clusters[c]) cout << "  " << describe(m) << "\n";
+    }
 
-    save_quiz_log(playername, category_str, difficulty_str, correct_count, wrong_count, score);
-    save_high_score(playername, score, category_str, difficulty_str);
-    post_quiz_menu();
-}
\ No newline at end of file
+    release_bank_cache();
+    return 0;
+}